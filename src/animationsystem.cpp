@@ -3,15 +3,26 @@
 #include "ecs/ecsengine.h"
 #include "ecs/entity.h"
 #include "input.h"
+#include "world.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/intersect.hpp>
 #include <iostream>
-#include <random>
+
+// what a random stream is drawn for, so the streams of one entity in one
+// tick are unrelated
+enum RandomPurpose : std::uint16_t {
+    CarDestination,
+    TeapotAngle,
+    TeapotJump,
+};
 
 AnimationSystem::AnimationSystem()
 {
+    writes<Tiger, Wolf, Car, Teapot, Spider, Hitbox, LastPose, Input>();
+    reads<SceneState, Prefabs>();
+    runAtFixedStep();
 }
 
 static glm::vec2 bezier(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, float t)
@@ -47,11 +58,30 @@ static float bezierCurvature(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, float t)
     return glm::length(bt) * glm::sign(dot);
 }
 
+static void recordPoses(ou::ECSEngine& engine)
+{
+    engine.parallelEach<LastPose, Hitbox const, Tiger const>([](ou::Entity&, LastPose& pose, Hitbox const& hitbox, Tiger const& tiger) {
+        pose = { hitbox.pos, tiger.angle };
+    });
+    engine.parallelEach<LastPose, Car const>([](ou::Entity&, LastPose& pose, Car const& car) {
+        pose = { glm::vec3(car.pos.x, 0, car.pos.y), car.angle };
+    });
+    // teapots come to rest, and are only marked as changed while they move
+    engine.parallelEach<LastPose const, Hitbox const, Teapot const>([](ou::Entity& ent, LastPose const& pose, Hitbox const& hitbox, Teapot const& teapot) {
+        if (pose.pos != hitbox.pos || pose.angle != teapot.angle) {
+            ent.get<LastPose>() = { hitbox.pos, teapot.angle };
+        }
+    });
+    engine.parallelEach<LastPose, Hitbox const, Spider const>([](ou::Entity&, LastPose& pose, Hitbox const& hitbox, Spider const& spider) {
+        pose = { hitbox.pos, spider.angle };
+    });
+}
+
 void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
 {
-    for (ou::Entity& ent : engine.iterate<Tiger>()) {
-        auto& tiger = ent.get<Tiger>();
-        auto& hitbox = ent.get<Hitbox>();
+    recordPoses(engine);
+
+    engine.parallelEach<Tiger, Hitbox>([&](ou::Entity&, Tiger& tiger, Hitbox& hitbox) {
         tiger.currFrame = glm::fract(tiger.elapsedTime / 0.2f) * 12;
         tiger.elapsedTime += deltaTime;
         glm::vec3 lastPos = hitbox.pos;
@@ -74,26 +104,22 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
 		float smoothing = 1 - glm::exp(-float(deltaTime) * 10.0);
 		float delta = glm::mod(tiger.angle - lastAngle + glm::radians(180.0f), glm::radians(360.0f)) - glm::radians(180.0f);
 		tiger.angle = lastAngle + delta * smoothing;
-    }
+    });
 
-    for (ou::Entity& ent : engine.iterate<Wolf>()) {
-        Wolf& wolf = ent.get<Wolf>();
+    engine.parallelEach<Wolf>([&](ou::Entity&, Wolf& wolf) {
         wolf.currFrame = glm::fract(wolf.elapsedTime / 0.5f) * 17;
         wolf.elapsedTime += deltaTime;
-    }
+    });
 
     float carSpeed = 300.0f;
-    for (ou::Entity& ent : engine.iterate<Car>()) {
-        Car& car = ent.get<Car>();
-        Hitbox& hitbox = ent.get<Hitbox>();
+    engine.parallelEach<Car, Hitbox>([&](ou::Entity& ent, Car& car, Hitbox& hitbox) {
 
         car.elapsedTime += deltaTime;
 
         // pick a new place to move to
+        ou::RandomStream random = engine.random(ent.id(), CarDestination);
         auto pickCoord = [&] {
-            std::uniform_real_distribution<float> dist(-1, 1);
-            glm::vec2 dest = glm::vec2(dist(engine.rand()), dist(engine.rand()));
-            return dest;
+            return glm::vec2(random.uniform(-1, 1), random.uniform(-1, 1));
         };
 
         while (car.dests.size() < 3) {
@@ -146,10 +172,10 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
         car.rearRot = std::atan2(rearDir.x, rearDir.y) - car.angle;
 
         hitbox.pos = glm::vec3(car.pos.x, 0, car.pos.y);
-    }
+    });
 
-    Input& input = engine.getOne<Input>();
-    SceneState const& scene = engine.getOne<SceneState>();
+    Input& input = engine.resource<Input>();
+    SceneState const& scene = engine.resource<SceneState const>();
 
     auto unproject = [&](glm::vec3& point) {
         if (!input.isMouseInScreen()) {
@@ -183,13 +209,14 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
 
     glm::vec3 mouseUnprojPos{};
     bool mouseOnFloor = unproject(mouseUnprojPos);
-    if (mouseOnFloor && !scene.secondCamOn && input.isKeyPressed('z') && input.isMouseClicked()) {
+    bool clicked = input.takeMouseClick();
+    if (mouseOnFloor && !scene.secondCamOn && input.isKeyPressed('z') && clicked) {
         Hitbox hitbox;
         hitbox.pos = mouseUnprojPos;
-		std::uniform_real_distribution<float> dist(0, glm::radians(360.0f));
 		Teapot teapot;
-		teapot.angle = dist(engine.rand());
-        engine.addEntity(ou::Entity{ teapot, hitbox });
+		teapot.angle = engine.random(ou::EntityId{}, TeapotAngle).uniform(0, glm::radians(360.0f));
+        engine.commands().instantiate(engine.resource<Prefabs const>().teapot, teapot, hitbox,
+            LastPose{ hitbox.pos, teapot.angle });
     }
 
     bool jump = false;
@@ -198,11 +225,13 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
         jump = true;
     }
 
-    for (ou::Entity& ent : engine.iterate<Teapot>()) {
-        auto& teapot = ent.get<Teapot>();
-        auto& hitbox = ent.get<Hitbox>();
+    bool spin = input.isKeyPressed('j');
 
-        if (input.isKeyPressed('j')) {
+    engine.parallelEach<Teapot const, Hitbox const>([&](ou::Entity& ent, Teapot const& current, Hitbox const& currentHitbox) {
+        Teapot teapot = current;
+        Hitbox hitbox = currentHitbox;
+
+        if (spin) {
             teapot.angle += glm::radians(360.0f) * deltaTime;
         }
 
@@ -234,14 +263,20 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
         }
 
         if (jump) {
-            std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
-            teapot.vel += glm::vec3(dist(engine.rand()), 1000.0f, dist(engine.rand()));
+            ou::RandomStream random = engine.random(ent.id(), TeapotJump);
+            teapot.vel += glm::vec3(random.uniform(-1000.0f, 1000.0f), 1000.0f, random.uniform(-1000.0f, 1000.0f));
         }
-    }
 
-    for (ou::Entity& ent : engine.iterate<Spider>()) {
-        auto& spider = ent.get<Spider>();
-        auto& hitbox = ent.get<Hitbox>();
+        // written back only if changed, so teapots at rest keep their matrices
+        if (teapot.vel != current.vel || teapot.angle != current.angle) {
+            ent.get<Teapot>() = teapot;
+        }
+        if (hitbox.pos != currentHitbox.pos) {
+            ent.get<Hitbox>().pos = hitbox.pos;
+        }
+    });
+
+    engine.parallelEach<Spider, Hitbox>([&](ou::Entity&, Spider& spider, Hitbox& hitbox) {
 
         if (mouseOnFloor) {
             glm::vec3 diff = mouseUnprojPos - hitbox.pos;
@@ -255,27 +290,31 @@ void AnimationSystem::update(ou::ECSEngine& engine, float deltaTime)
                 spider.elapsedTime += deltaTime;
             }
         }
-    }
-
-    // collision detection
-    for (ou::Entity& ent : engine.iterate<Hitbox>()) {
-        auto& a = ent.get<Hitbox>();
-
-        for (ou::Entity& ent : engine.iterate<Hitbox>()) {
-            auto& b = ent.get<Hitbox>();
-
-            if (&a == &b) {
-                continue;
-            }
-
-            auto diff = a.pos - b.pos;
-            auto length = glm::length(diff);
-            if (length < a.size + b.size) {
-                diff = glm::normalize(diff) * (length - (a.size + b.size));
-                auto norm = 1.f / (a.weight + b.weight);
-                a.pos -= diff * b.weight * norm;
-                b.pos += diff * a.weight * norm;
-            }
+    });
+
+    // collision detection, testing only hitboxes in neighbouring cells and
+    // each pair once; only hitboxes that collide are marked as changed
+    m_hitboxes.clear();
+    m_hitboxIds.clear();
+    m_broadPhase.clear();
+    engine.view<Hitbox const>().each([&](ou::Entity const& ent, Hitbox const& hitbox) {
+        m_hitboxes.push_back(&hitbox);
+        m_hitboxIds.push_back(ent.id());
+        m_broadPhase.insert(hitbox.pos, hitbox.size);
+    });
+    m_broadPhase.build();
+    m_broadPhase.forEachPair([&](std::uint32_t i, std::uint32_t j) {
+        Hitbox const& a = *m_hitboxes[i];
+        Hitbox const& b = *m_hitboxes[j];
+        auto diff = a.pos - b.pos;
+        auto length = glm::length(diff);
+        if (length < a.size + b.size) {
+            // hitboxes at the same spot are pushed apart along x
+            auto dir = length > 0 ? diff / length : glm::vec3(1, 0, 0);
+            diff = dir * (length - (a.size + b.size));
+            auto norm = 1.f / (a.weight + b.weight);
+            engine.get<Hitbox>(m_hitboxIds[i]).pos -= diff * b.weight * norm;
+            engine.get<Hitbox>(m_hitboxIds[j]).pos += diff * a.weight * norm;
         }
-    }
+    });
 }
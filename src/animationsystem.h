@@ -1,10 +1,21 @@
 #ifndef ANIMATIONSYSTEM_H
 #define ANIMATIONSYSTEM_H
 
+#include "ecs/entity.h"
 #include "ecs/entitysystem.h"
+#include "spatialhash.h"
+
+#include <vector>
+
+struct Hitbox;
 
 class AnimationSystem : public ou::EntitySystem
 {
+    // collision broad phase, rebuilt every tick
+    SpatialHash m_broadPhase;
+    std::vector<Hitbox const*> m_hitboxes;
+    std::vector<ou::EntityId> m_hitboxIds;
+
 public:
     AnimationSystem();
 
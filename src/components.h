@@ -38,6 +38,13 @@ struct Hitbox {
     float size{ 50.f };
 };
 
+// Hitbox position and heading at the start of the last simulation tick, so
+// rendering can interpolate between the last two ticks
+struct LastPose {
+    glm::vec3 pos{};
+    float angle{};
+};
+
 struct Spider {
     int currFrame = 0;
     float elapsedTime = 0;
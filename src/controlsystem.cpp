@@ -11,13 +11,15 @@
 
 ControlSystem::ControlSystem()
 {
+    writes<SceneState, Input>();
+    runOnMainThread();
 }
 
 void ControlSystem::update(ou::ECSEngine& engine, float deltaTime)
 {
     // Update mouse cursor position
-    SceneState& scene = engine.getOne<SceneState>();
-    Input& input = engine.getOne<Input>();
+    SceneState& scene = engine.resource<SceneState>();
+    Input& input = engine.resource<Input>();
 
     input.update(deltaTime, scene.windowSize);
 
@@ -152,6 +154,6 @@ void ControlSystem::update(ou::ECSEngine& engine, float deltaTime)
 
 void ControlSystem::afterUpdate(ou::ECSEngine& engine)
 {
-    Input& input = engine.getOne<Input>();
+    Input& input = engine.resource<Input>();
     input.afterUpdate();
 }
@@ -0,0 +1,19 @@
+#include "allocationcounter.h"
+
+namespace {
+
+thread_local std::uint64_t t_allocations = 0;
+}
+
+namespace ou {
+
+std::uint64_t AllocationCounter::thisThread()
+{
+    return t_allocations;
+}
+
+void AllocationCounter::count()
+{
+    ++t_allocations;
+}
+}
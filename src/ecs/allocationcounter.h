@@ -0,0 +1,23 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+namespace ou {
+
+// Counts the calls to the global operator new. Replacing the allocator is
+// left to the programs that want the counts: ecs_bench compiles in
+// countingallocator.cpp, and so does every program using the library when
+// CMake is run with ECS_COUNT_ALLOCATIONS=ON. Elsewhere the counts stay 0.
+// Counts are kept per thread so that counting costs no synchronisation.
+class AllocationCounter {
+public:
+    // allocations made on the calling thread since it started
+    static std::uint64_t thisThread();
+
+    // called by the replaced operator new
+    static void count();
+};
+}
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,221 @@
+#include "archetype.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ou {
+
+Archetype::Archetype(Columns&& columns, std::vector<ComponentId>&& tags, std::vector<EntityRecord>& records,
+    std::uint64_t const& clock)
+    : m_columns(std::move(columns))
+    , m_tags(std::move(tags))
+    , m_records(records)
+    , m_clock(clock)
+{
+    for (auto const& col : m_columns) {
+        ComponentId id = col->componentId();
+        if (id >= m_columnsById.size()) {
+            m_columnsById.resize(id + 1);
+        }
+        m_columnsById[id] = col.get();
+        m_signature.set(id);
+        col->setClock(&m_clock);
+    }
+    for (ComponentId id : m_tags) {
+        m_signature.set(id);
+    }
+}
+
+Signature const& Archetype::signature() const
+{
+    return m_signature;
+}
+
+bool Archetype::has(ComponentId id) const
+{
+    return m_signature.test(id);
+}
+
+std::vector<ComponentId> const& Archetype::tags() const
+{
+    return m_tags;
+}
+
+std::size_t Archetype::size() const
+{
+    return m_entities.size();
+}
+
+ColumnBase& Archetype::column(ComponentId id)
+{
+    if (id >= m_columnsById.size() || !m_columnsById[id]) {
+        throw std::runtime_error("Component does not exist");
+    }
+    return *m_columnsById[id];
+}
+
+Archetype::Columns const& Archetype::columns() const
+{
+    return m_columns;
+}
+
+std::uint64_t Archetype::layoutVersion() const
+{
+    return m_layoutVersion;
+}
+
+Entity& Archetype::entity(std::size_t row)
+{
+    return m_entities[row];
+}
+
+Entity* Archetype::entities()
+{
+    return m_entities.data();
+}
+
+Archetype::Columns Archetype::cloneEmptyColumns() const
+{
+    Columns columns;
+    for (auto const& col : m_columns) {
+        columns.push_back(col->cloneEmpty());
+    }
+    return columns;
+}
+
+void Archetype::reserve(std::size_t rows)
+{
+    for (auto const& col : m_columns) {
+        col->reserve(rows);
+    }
+    m_entities.reserve(rows);
+}
+
+void Archetype::grow(std::size_t rows)
+{
+    std::size_t needed = m_entities.size() + rows;
+    if (needed > m_entities.capacity()) {
+        reserve(std::max(needed, 2 * m_entities.capacity()));
+    }
+}
+
+void Archetype::push(Entity&& entity)
+{
+    m_entities.push_back(std::move(entity));
+    EntityRecord& record = m_records[m_entities.back().m_id.index];
+    record.archetype = this;
+    record.row = m_entities.size() - 1;
+    m_layoutVersion = m_clock;
+}
+
+void Archetype::moveRowTo(std::size_t row, Archetype& other)
+{
+    for (auto const& col : m_columns) {
+        ComponentId id = col->componentId();
+        if (id < other.m_columnsById.size() && other.m_columnsById[id]) {
+            other.m_columnsById[id]->moveFrom(*col, row);
+        }
+    }
+    other.push(std::move(m_entities[row]));
+    swapRemove(row);
+}
+
+void Archetype::swapRemove(std::size_t row)
+{
+    for (auto const& col : m_columns) {
+        col->swapRemove(row);
+    }
+    if (row + 1 != m_entities.size()) {
+        m_entities[row] = std::move(m_entities.back());
+        m_records[m_entities[row].m_id.index].row = row;
+    }
+    m_entities.pop_back();
+    m_layoutVersion = m_clock;
+}
+
+void Archetype::removeRows(std::size_t const* rows, std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    for (auto const& col : m_columns) {
+        col->removeRows(rows, count);
+    }
+    eraseRows(m_entities, rows, count);
+    for (std::size_t row = rows[0]; row < m_entities.size(); ++row) {
+        m_records[m_entities[row].m_id.index].row = row;
+    }
+    m_layoutVersion = m_clock;
+}
+
+void Archetype::clear()
+{
+    for (auto const& col : m_columns) {
+        col->clear();
+    }
+    m_entities.clear();
+    m_layoutVersion = m_clock;
+}
+
+void Archetype::assign(ECSEngine& engine, std::vector<EntityId> const& ids,
+    std::vector<std::shared_ptr<ColumnBase const>> const& columns)
+{
+    for (std::size_t i = 0; i < m_columns.size(); ++i) {
+        m_columns[i]->assign(*columns[i]);
+    }
+    setEntities(engine, ids);
+}
+
+void Archetype::take(ECSEngine& engine, std::vector<EntityId> const& ids, std::vector<ColumnBase*> const& columns)
+{
+    for (std::size_t i = 0; i < m_columns.size(); ++i) {
+        m_columns[i]->take(*columns[i]);
+    }
+    setEntities(engine, ids);
+}
+
+void Archetype::setEntities(ECSEngine& engine, std::vector<EntityId> const& ids)
+{
+    m_entities.resize(ids.size());
+    for (std::size_t row = 0; row < ids.size(); ++row) {
+        m_entities[row].m_engine = &engine;
+        m_entities[row].m_id = ids[row];
+    }
+    m_layoutVersion = m_clock;
+}
+
+static Archetype* edge(std::vector<Archetype*> const& edges, ComponentId id)
+{
+    return id < edges.size() ? edges[id] : nullptr;
+}
+
+static void setEdge(std::vector<Archetype*>& edges, ComponentId id, Archetype* archetype)
+{
+    if (id >= edges.size()) {
+        edges.resize(id + 1);
+    }
+    edges[id] = archetype;
+}
+
+Archetype* Archetype::addEdge(ComponentId id) const
+{
+    return edge(m_addEdges, id);
+}
+
+Archetype* Archetype::removeEdge(ComponentId id) const
+{
+    return edge(m_removeEdges, id);
+}
+
+void Archetype::setAddEdge(ComponentId id, Archetype* archetype)
+{
+    setEdge(m_addEdges, id, archetype);
+}
+
+void Archetype::setRemoveEdge(ComponentId id, Archetype* archetype)
+{
+    setEdge(m_removeEdges, id, archetype);
+}
+
+ColumnBase::~ColumnBase() = default;
+}
@@ -0,0 +1,117 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include "column.h"
+#include "entity.h"
+#include "signature.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ou {
+
+class Archetype;
+
+// Where a live entity is stored, indexed by EntityId::index
+struct EntityRecord {
+    Archetype* archetype = nullptr;
+    std::size_t row = 0;
+    std::uint32_t generation = 0;
+};
+
+// Stores every entity that has exactly the same set of components.
+// Each component type gets its own contiguous column, and row i of every
+// column belongs to m_entities[i]. Tags get no column, only a bit in the
+// signature.
+class Archetype {
+public:
+    using Columns = std::vector<std::unique_ptr<ColumnBase>>;
+
+private:
+    Signature m_signature;
+    Columns m_columns;
+    std::vector<ColumnBase*> m_columnsById; // null for types without a column
+    std::vector<ComponentId> m_tags;
+    std::vector<Entity> m_entities;
+    std::vector<EntityRecord>& m_records;
+    std::uint64_t const& m_clock;
+
+    // clock when rows were last added, removed or reordered
+    std::uint64_t m_layoutVersion = 0;
+
+    // indexed by ComponentId, null until the edge is first taken
+    std::vector<Archetype*> m_addEdges;
+    std::vector<Archetype*> m_removeEdges;
+
+    void setEntities(ECSEngine& engine, std::vector<EntityId> const& ids);
+
+public:
+    // clock is the engine version new and touched rows are stamped with
+    Archetype(Columns&& columns, std::vector<ComponentId>&& tags, std::vector<EntityRecord>& records,
+        std::uint64_t const& clock);
+
+    Archetype(Archetype const&) = delete;
+    Archetype& operator=(Archetype const&) = delete;
+
+    // all component types, tags included
+    Signature const& signature() const;
+
+    bool has(ComponentId id) const;
+
+    std::vector<ComponentId> const& tags() const;
+
+    std::size_t size() const;
+
+    ColumnBase& column(ComponentId id);
+
+    Columns const& columns() const;
+
+    std::uint64_t layoutVersion() const;
+
+    template <typename T>
+    T* data() { return static_cast<Column<T>&>(column(ComponentIds::id<T>())).data(); }
+
+    Entity& entity(std::size_t row);
+
+    Entity* entities();
+
+    Columns cloneEmptyColumns() const;
+
+    void reserve(std::size_t rows);
+
+    // Makes room for rows more rows, at least doubling the storage when it
+    // has to grow, so adding a few rows at a time stays amortized linear.
+    void grow(std::size_t rows);
+
+    // the component columns must have been pushed to beforehand
+    void push(Entity&& entity);
+
+    // moves the row into another archetype, carrying over the components both share
+    void moveRowTo(std::size_t row, Archetype& other);
+
+    void swapRemove(std::size_t row);
+
+    // rows must be ascending; the remaining rows keep their order
+    void removeRows(std::size_t const* rows, std::size_t count);
+
+    // drops every row without touching the entity records
+    void clear();
+
+    // Replaces every row with the given entities and copies of columns(), in
+    // the same order. Does not touch the entity records.
+    void assign(ECSEngine& engine, std::vector<EntityId> const& ids,
+        std::vector<std::shared_ptr<ColumnBase const>> const& columns);
+
+    // Like assign, but takes the values of the columns over, leaving them
+    // empty.
+    void take(ECSEngine& engine, std::vector<EntityId> const& ids, std::vector<ColumnBase*> const& columns);
+
+    Archetype* addEdge(ComponentId id) const;
+    Archetype* removeEdge(ComponentId id) const;
+    void setAddEdge(ComponentId id, Archetype* archetype);
+    void setRemoveEdge(ComponentId id, Archetype* archetype);
+};
+}
+
+#endif // ARCHETYPE_H
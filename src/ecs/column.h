@@ -0,0 +1,217 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "signature.h"
+
+namespace ou {
+
+// Removes the given rows, in ascending order, shifting the others down.
+template <typename T>
+void eraseRows(std::vector<T>& values, std::size_t const* rows, std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    auto out = values.begin() + rows[0];
+    for (std::size_t i = 0; i < count; ++i) {
+        auto end = i + 1 < count ? values.begin() + rows[i + 1] : values.end();
+        out = std::move(values.begin() + rows[i] + 1, end, out);
+    }
+    values.erase(out, values.end());
+}
+
+// Besides the values, a column remembers for every row the engine version at
+// which it was last added or accessed mutably, and the latest of those.
+class ColumnBase {
+protected:
+    ComponentId m_componentId = 0;
+    std::vector<std::uint64_t> m_versions;
+    std::atomic<std::uint64_t> m_version{ 0 };
+    std::uint64_t const* m_clock = nullptr;
+
+    std::uint64_t now() const { return m_clock ? *m_clock : 0; }
+
+    void pushVersion(std::uint64_t version)
+    {
+        m_versions.push_back(version);
+        if (version > m_version.load(std::memory_order_relaxed)) {
+            m_version.store(version, std::memory_order_relaxed);
+        }
+    }
+
+    void pushVersions(std::uint64_t version, std::size_t count)
+    {
+        m_versions.insert(m_versions.end(), count, version);
+        if (count > 0 && version > m_version.load(std::memory_order_relaxed)) {
+            m_version.store(version, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    virtual ~ColumnBase();
+    virtual std::size_t size() const = 0;
+    virtual void reserve(std::size_t rows) = 0;
+    virtual void* at(std::size_t row) = 0;
+    virtual void moveFrom(ColumnBase& other, std::size_t row) = 0;
+    virtual void swapRemove(std::size_t row) = 0;
+    virtual void clear() = 0;
+    // rows must be ascending; the remaining rows keep their order
+    virtual void removeRows(std::size_t const* rows, std::size_t count) = 0;
+    // value must point to a T of the column
+    virtual void pushCopies(void const* value, std::size_t count) = 0;
+    virtual std::unique_ptr<ColumnBase> cloneEmpty() const = 0;
+    // a copy of the values, without their versions
+    virtual std::unique_ptr<ColumnBase> copy() const = 0;
+    // overwrites an earlier copy, reusing its memory
+    virtual void copyTo(ColumnBase& copy) const = 0;
+    // replaces the values with those of a copy and marks every row as changed
+    virtual void assign(ColumnBase const& copy) = 0;
+    // like assign, but takes the values over, leaving the other column empty
+    virtual void take(ColumnBase& values) = 0;
+    // memory taken by the values, not counting what they point to
+    virtual std::size_t bytes() const = 0;
+
+    void setClock(std::uint64_t const* clock) { m_clock = clock; }
+
+    ComponentId componentId() const { return m_componentId; }
+
+    std::uint64_t version() const { return m_version.load(std::memory_order_relaxed); }
+
+    std::uint64_t const* versions() const { return m_versions.data(); }
+
+    // marks rows as changed at the current version; different threads may
+    // touch different rows at the same time
+    void touch(std::size_t row) { touch(row, row + 1); }
+
+    void touch(std::size_t begin, std::size_t end)
+    {
+        std::uint64_t version = now();
+        std::fill(m_versions.begin() + begin, m_versions.begin() + end, version);
+        m_version.store(version, std::memory_order_relaxed);
+    }
+};
+
+template <typename T>
+class Column final : public ColumnBase {
+    std::vector<T> m_data;
+
+public:
+    Column() { m_componentId = ComponentIds::id<T>(); }
+
+    std::size_t size() const override { return m_data.size(); }
+
+    void reserve(std::size_t rows) override
+    {
+        m_data.reserve(rows);
+        m_versions.reserve(rows);
+    }
+
+    void* at(std::size_t row) override { return &m_data[row]; }
+
+    void moveFrom(ColumnBase& other, std::size_t row) override
+    {
+        auto& column = static_cast<Column<T>&>(other);
+        m_data.push_back(std::move(column.m_data[row]));
+        pushVersion(column.m_versions[row]);
+    }
+
+    void swapRemove(std::size_t row) override
+    {
+        if (row + 1 != m_data.size()) {
+            m_data[row] = std::move(m_data.back());
+            m_versions[row] = m_versions.back();
+        }
+        m_data.pop_back();
+        m_versions.pop_back();
+    }
+
+    void clear() override
+    {
+        m_data.clear();
+        m_versions.clear();
+    }
+
+    void removeRows(std::size_t const* rows, std::size_t count) override
+    {
+        eraseRows(m_data, rows, count);
+        eraseRows(m_versions, rows, count);
+    }
+
+    void pushCopies(void const* value, std::size_t count) override
+    {
+        m_data.insert(m_data.end(), count, *static_cast<T const*>(value));
+        pushVersions(now(), count);
+    }
+
+    std::unique_ptr<ColumnBase> cloneEmpty() const override
+    {
+        return std::make_unique<Column<T>>();
+    }
+
+    std::unique_ptr<ColumnBase> copy() const override
+    {
+        auto column = std::make_unique<Column<T>>();
+        column->m_data = m_data;
+        return std::unique_ptr<ColumnBase>(std::move(column));
+    }
+
+    void copyTo(ColumnBase& copy) const override
+    {
+        static_cast<Column<T>&>(copy).m_data = m_data;
+    }
+
+    void assign(ColumnBase const& copy) override
+    {
+        m_data = static_cast<Column<T> const&>(copy).m_data;
+        m_versions.assign(m_data.size(), now());
+        m_version.store(now(), std::memory_order_relaxed);
+    }
+
+    void take(ColumnBase& values) override
+    {
+        auto& column = static_cast<Column<T>&>(values);
+        m_data.swap(column.m_data);
+        column.clear();
+        m_versions.assign(m_data.size(), now());
+        m_version.store(now(), std::memory_order_relaxed);
+    }
+
+    std::size_t bytes() const override { return m_data.capacity() * sizeof(T); }
+
+    void push(T&& value)
+    {
+        m_data.push_back(std::move(value));
+        pushVersion(now());
+    }
+
+    // Appends count values copied byte for byte, only for trivially copyable
+    // T. The bytes need not be aligned for T. Values are appended one by one
+    // rather than resizing first, which would zero them only to overwrite
+    // them.
+    void appendBytes(void const* bytes, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Column values are not trivially copyable");
+        auto in = static_cast<unsigned char const*>(bytes);
+        m_data.reserve(m_data.size() + count);
+        for (std::size_t i = 0; i < count; ++i) {
+            T value;
+            std::memcpy(&value, in + i * sizeof(T), sizeof(T));
+            m_data.push_back(value);
+        }
+        pushVersions(now(), count);
+    }
+
+    T* data() { return m_data.data(); }
+};
+}
+
+#endif // COLUMN_H
@@ -0,0 +1,34 @@
+#include "commandbuffer.h"
+
+namespace ou {
+
+void CommandBuffer::spawn(Entity&& entity)
+{
+    m_spawnSizes.push_back(entity.m_components.size());
+    for (auto& comp : entity.m_components) {
+        m_spawned.push_back(std::move(comp));
+    }
+    entity.m_components.clear();
+}
+
+void CommandBuffer::destroy(EntityId id)
+{
+    m_destroys.push_back(id);
+}
+
+bool CommandBuffer::empty() const
+{
+    return m_spawnSizes.empty() && m_instances.empty() && m_destroys.empty() && m_changes.empty();
+}
+
+void CommandBuffer::clear()
+{
+    m_spawned.clear();
+    m_spawnSizes.clear();
+    m_destroys.clear();
+    m_changes.clear();
+    m_added.clear();
+    m_instances.clear();
+    m_overrides.clear();
+}
+}
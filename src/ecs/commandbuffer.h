@@ -0,0 +1,84 @@
+#ifndef COMMANDBUFFER_H
+#define COMMANDBUFFER_H
+
+#include "entity.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ou {
+
+// Records structural changes so they can be applied later at a sync point,
+// when no system is iterating over the engine.
+class CommandBuffer {
+    friend class ECSEngine;
+
+    struct Change {
+        EntityId id;
+        ComponentId component;
+        bool add;
+    };
+
+    // components of all spawned entities back to back, with the number each
+    // entity takes, so the storage is reused from one frame to the next
+    std::vector<Component> m_spawned;
+    std::vector<std::size_t> m_spawnSizes;
+    std::vector<EntityId> m_destroys;
+    std::vector<Change> m_changes;
+    std::vector<Component> m_added; // one per change with add set, in order
+
+    struct Instance {
+        PrefabId prefab;
+        std::size_t overrides;
+    };
+
+    // overrides of all instances back to back, like spawned components
+    std::vector<Instance> m_instances;
+    std::vector<Component> m_overrides;
+
+public:
+    void spawn(Entity&& entity);
+
+    // each component type may appear only once
+    template <typename T0, typename... Ts>
+    void spawn(T0&& comp, Ts&&... comps)
+    {
+        m_spawnSizes.push_back(1 + sizeof...(Ts));
+        m_spawned.emplace_back(std::forward<T0>(comp));
+        int expand[] = { 0, (m_spawned.emplace_back(std::forward<Ts>(comps)), 0)... };
+        (void)expand;
+    }
+
+    // an entity of the prefab, with the given components in place of the
+    // prefab's defaults
+    template <typename... Ts>
+    void instantiate(PrefabId prefab, Ts&&... overrides)
+    {
+        m_instances.push_back({ prefab, sizeof...(Ts) });
+        int expand[] = { 0, (m_overrides.emplace_back(std::forward<Ts>(overrides)), 0)... };
+        (void)expand;
+    }
+
+    void destroy(EntityId id);
+
+    template <typename T>
+    void add(EntityId id, T component)
+    {
+        m_changes.push_back({ id, ComponentIds::id<T>(), true });
+        m_added.emplace_back(std::move(component));
+    }
+
+    template <typename T>
+    void remove(EntityId id)
+    {
+        m_changes.push_back({ id, ComponentIds::id<T>(), false });
+    }
+
+    bool empty() const;
+
+    void clear();
+};
+}
+
+#endif // COMMANDBUFFER_H
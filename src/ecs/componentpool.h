@@ -0,0 +1,159 @@
+#ifndef COMPONENTPOOL_H
+#define COMPONENTPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace ou {
+
+// Recycles storage for components too large to be kept inline. Every thread
+// keeps a few free blocks per type, so most calls take no lock; beyond that
+// they go back to a list shared by all threads, so blocks released on
+// another thread than the one they were allocated on are reused all the same.
+template <typename T>
+class ComponentPool {
+    union Block {
+        Block* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr std::size_t CacheSize = 64;
+
+    struct Shared {
+        std::mutex mutex;
+        Block* head = nullptr;
+
+        ~Shared()
+        {
+            while (head) {
+                Block* next = head->next;
+                deleteBlock(head);
+                head = next;
+            }
+        }
+    };
+
+    static Shared& shared()
+    {
+        static Shared list;
+        return list;
+    }
+
+    struct Cache {
+        Block* head = nullptr;
+        std::size_t size = 0;
+
+        // the shared list is created first, so it outlives the caches
+        Cache() { shared(); }
+
+        ~Cache() { giveBack(*this, size); }
+    };
+
+    static Cache& cache()
+    {
+        static thread_local Cache list;
+        return list;
+    }
+
+    // moves the first count blocks of a cache to the shared list
+    static void giveBack(Cache& cache, std::size_t count) noexcept
+    {
+        if (count == 0) {
+            return;
+        }
+        Block* first = cache.head;
+        Block* last = first;
+        for (std::size_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        cache.head = last->next;
+        cache.size -= count;
+
+        Shared& list = shared();
+        std::lock_guard<std::mutex> lock(list.mutex);
+        last->next = list.head;
+        list.head = first;
+    }
+
+    // moves up to half a cache worth of blocks from the shared list
+    static void take(Cache& cache)
+    {
+        Shared& list = shared();
+        std::lock_guard<std::mutex> lock(list.mutex);
+        while (list.head && cache.size < CacheSize / 2) {
+            Block* block = list.head;
+            list.head = block->next;
+            block->next = cache.head;
+            cache.head = block;
+            ++cache.size;
+        }
+    }
+
+    // Before C++17 operator new only aligns to max_align_t, so over-aligned
+    // blocks are placed in a larger allocation whose address is kept just in
+    // front of them.
+    using OverAligned = std::integral_constant<bool, (alignof(Block) > alignof(std::max_align_t))>;
+
+    static Block* newBlock(std::false_type)
+    {
+        return static_cast<Block*>(::operator new(sizeof(Block)));
+    }
+
+    static Block* newBlock(std::true_type)
+    {
+        void* raw = ::operator new(sizeof(void*) + alignof(Block) - 1 + sizeof(Block));
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        address = (address + alignof(Block) - 1) & ~std::uintptr_t(alignof(Block) - 1);
+        Block* block = reinterpret_cast<Block*>(address);
+        reinterpret_cast<void**>(block)[-1] = raw;
+        return block;
+    }
+
+    static void deleteBlock(Block* block, std::false_type) noexcept
+    {
+        ::operator delete(block);
+    }
+
+    static void deleteBlock(Block* block, std::true_type) noexcept
+    {
+        ::operator delete(reinterpret_cast<void**>(block)[-1]);
+    }
+
+    static void deleteBlock(Block* block) noexcept
+    {
+        deleteBlock(block, OverAligned{});
+    }
+
+public:
+    static void* allocate()
+    {
+        Cache& list = cache();
+        if (!list.head) {
+            take(list);
+            if (!list.head) {
+                return newBlock(OverAligned{});
+            }
+        }
+        Block* block = list.head;
+        list.head = block->next;
+        --list.size;
+        return block;
+    }
+
+    static void release(void* ptr) noexcept
+    {
+        Cache& list = cache();
+        Block* block = static_cast<Block*>(ptr);
+        block->next = list.head;
+        list.head = block;
+        if (++list.size > CacheSize) {
+            giveBack(list, CacheSize / 2);
+        }
+    }
+};
+}
+
+#endif // COMPONENTPOOL_H
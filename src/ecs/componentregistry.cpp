@@ -0,0 +1,30 @@
+#include "componentregistry.h"
+
+#include <stdexcept>
+
+namespace ou {
+
+void ComponentRegistry::add(ComponentInfo&& info)
+{
+    if (find(info.id) || find(info.name)) {
+        throw std::runtime_error("Component registered twice: " + info.name);
+    }
+    if (info.id >= m_byId.size()) {
+        m_byId.resize(info.id + 1, -1);
+    }
+    m_byId[info.id] = static_cast<int>(m_infos.size());
+    m_byName[info.name] = m_infos.size();
+    m_infos.push_back(std::move(info));
+}
+
+ComponentInfo const* ComponentRegistry::find(ComponentId id) const
+{
+    return id < m_byId.size() && m_byId[id] >= 0 ? &m_infos[m_byId[id]] : nullptr;
+}
+
+ComponentInfo const* ComponentRegistry::find(std::string const& name) const
+{
+    auto it = m_byName.find(name);
+    return it != m_byName.end() ? &m_infos[it->second] : nullptr;
+}
+}
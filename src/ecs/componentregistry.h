@@ -0,0 +1,109 @@
+#ifndef COMPONENTREGISTRY_H
+#define COMPONENTREGISTRY_H
+
+#include "column.h"
+#include "signature.h"
+#include "snapshot.h"
+#include "tags.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ou {
+
+// What a snapshot needs to know about a component type. Snapshots refer to
+// types by name, since ComponentIds differ between runs.
+struct ComponentInfo {
+    std::string name;
+    ComponentId id;
+
+    bool isTag;
+
+    // bytes per row if whole columns are copied as they are in memory, 0 if
+    // the values are written one by one
+    std::size_t rawSize;
+
+    std::unique_ptr<ColumnBase> (*makeColumn)();
+
+    // writes all rows of a column
+    std::function<void(ColumnBase& column, SnapshotWriter& out)> write;
+
+    // appends rows to a column
+    std::function<void(ColumnBase& column, std::size_t rows, SnapshotReader& in)> read;
+};
+
+// The component types that can be saved, each under a name that must not
+// change between the runs that save and load a snapshot.
+class ComponentRegistry {
+    std::vector<ComponentInfo> m_infos;
+
+    // indexed by ComponentId, an index into m_infos or -1
+    std::vector<int> m_byId;
+    std::unordered_map<std::string, std::size_t> m_byName;
+
+    template <typename T>
+    static std::unique_ptr<ColumnBase> makeColumn() { return std::make_unique<Column<T>>(); }
+
+    void add(ComponentInfo&& info);
+
+    template <typename T>
+    void addRaw(std::string&& name, std::true_type)
+    {
+        add({ std::move(name), ComponentIds::id<T>(), true, 0, nullptr, nullptr, nullptr });
+    }
+
+    template <typename T>
+    void addRaw(std::string&& name, std::false_type)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "Components that are not trivially copyable need functions to save and load them");
+        auto write = [](ColumnBase& column, SnapshotWriter& out) {
+            out.write(static_cast<Column<T>&>(column).data(), column.size() * sizeof(T));
+        };
+        auto read = [](ColumnBase& column, std::size_t rows, SnapshotReader& in) {
+            static_cast<Column<T>&>(column).appendBytes(in.read(rows, sizeof(T)), rows);
+        };
+        add({ std::move(name), ComponentIds::id<T>(), false, sizeof(T), &makeColumn<T>, write, read });
+    }
+
+public:
+    // Tags and trivially copyable types, whose columns are saved and loaded
+    // with a single copy each
+    template <typename T>
+    void add(std::string name)
+    {
+        addRaw<T>(std::move(name), IsTag<T>{});
+    }
+
+    // Other types, with functions that save and load one value
+    template <typename T>
+    void add(std::string name, void (*save)(T const&, SnapshotWriter&), T (*load)(SnapshotReader&))
+    {
+        auto write = [save](ColumnBase& column, SnapshotWriter& out) {
+            T const* values = static_cast<Column<T>&>(column).data();
+            for (std::size_t row = 0; row < column.size(); ++row) {
+                save(values[row], out);
+            }
+        };
+        auto read = [load](ColumnBase& column, std::size_t rows, SnapshotReader& in) {
+            auto& values = static_cast<Column<T>&>(column);
+            for (std::size_t row = 0; row < rows; ++row) {
+                values.push(load(in));
+            }
+        };
+        add({ std::move(name), ComponentIds::id<T>(), false, 0, &makeColumn<T>, write, read });
+    }
+
+    // null if the type is not registered
+    ComponentInfo const* find(ComponentId id) const;
+    ComponentInfo const* find(std::string const& name) const;
+};
+}
+
+#endif // COMPONENTREGISTRY_H
@@ -0,0 +1,257 @@
+// Microbenchmarks for ECSEngine. Prints the time and heap allocations per
+// operation for a range of entity counts.
+
+#include "allocationcounter.h"
+#include "ecsengine.h"
+#include "entity.h"
+#include "entitysystem.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace {
+
+// results are written here so the measured loops are not optimised away
+volatile float g_sink;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct Health {
+    int hp;
+};
+
+struct Marker {
+    int value;
+};
+
+struct Result {
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+// times body, which performs ops operations
+Result measure(std::size_t ops, std::function<void()> const& body)
+{
+    using namespace std::chrono;
+    std::uint64_t allocs = ou::AllocationCounter::thisThread();
+    auto start = steady_clock::now();
+    body();
+    auto elapsed = duration<double, std::nano>(steady_clock::now() - start).count();
+    allocs = ou::AllocationCounter::thisThread() - allocs;
+    return { elapsed / ops, static_cast<double>(allocs) / ops };
+}
+
+// runs body once untimed, so the queries it uses are built and cached
+// before it is timed
+Result measureWarm(std::size_t ops, std::function<void()> const& body)
+{
+    body();
+    return measure(ops, body);
+}
+
+void report(char const* name, std::size_t entities, Result result)
+{
+    std::printf("%-28s %9zu %12.2f %12.3f\n", name, entities, result.nsPerOp, result.allocsPerOp);
+}
+
+std::vector<ou::EntityId> populate(ou::ECSEngine& engine, std::size_t count)
+{
+    std::vector<ou::EntityId> ids;
+    ids.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        float f = static_cast<float>(i);
+        ids.push_back(engine.addEntity(ou::Entity{ Position{ f, f, f }, Velocity{ 1, 1, 1 }, Health{ 100 } }));
+    }
+    return ids;
+}
+
+void benchAddEntity(std::size_t count)
+{
+    ou::ECSEngine engine;
+    report("addEntity", count, measure(count, [&] { populate(engine, count); }));
+}
+
+void benchSpawnBatch(std::size_t count)
+{
+    ou::ECSEngine engine;
+    ou::Entity prototype{ Position{ 0, 0, 0 }, Velocity{ 1, 1, 1 }, Health{ 100 } };
+    report("spawnBatch", count, measure(count, [&] { engine.spawnBatch(count, prototype); }));
+}
+
+void benchInstantiate(std::size_t count)
+{
+    ou::ECSEngine engine;
+    ou::PrefabId prefab = engine.addPrefab(ou::Entity{ Position{ 0, 0, 0 }, Velocity{ 1, 1, 1 }, Health{ 100 } });
+    ou::Entity overrides{ Velocity{ 0, 1, 0 } };
+    report("instantiate", count, measure(count, [&] { engine.instantiate(prefab, count, overrides); }));
+}
+
+void benchRemoveEntities(std::size_t count)
+{
+    ou::ECSEngine engine;
+    populate(engine, count);
+    // builds the query, removing nothing
+    engine.removeEntities<Health>([](ou::Entity&) { return false; });
+    report("removeEntities (half)", count, measure(count, [&] {
+        engine.removeEntities<Health>([](ou::Entity& ent) { return ent.id().index % 2 == 0; });
+    }));
+}
+
+void benchDespawnIf(std::size_t count)
+{
+    ou::ECSEngine engine;
+    populate(engine, count);
+    // builds the query, despawning nothing
+    engine.despawnIf<Health const>([](ou::Entity&, Health const&) { return false; });
+    report("despawnIf (half)", count, measure(count, [&] {
+        engine.despawnIf<Health const>([](ou::Entity& ent, Health const&) { return ent.id().index % 2 == 0; });
+    }));
+}
+
+void benchIterate(std::size_t count)
+{
+    ou::ECSEngine engine;
+    populate(engine, count);
+    float sum = 0;
+
+    report("iterate<1>", count, measureWarm(count, [&] {
+        for (ou::Entity& ent : engine.iterate<Position>()) {
+            sum += ent.get<Position const>().x;
+        }
+    }));
+    report("iterate<2>", count, measureWarm(count, [&] {
+        for (ou::Entity& ent : engine.iterate<Position, Velocity>()) {
+            sum += ent.get<Position const>().x + ent.get<Velocity const>().x;
+        }
+    }));
+    report("iterate<3>", count, measureWarm(count, [&] {
+        for (ou::Entity& ent : engine.iterate<Position, Velocity, Health>()) {
+            sum += ent.get<Position const>().x + ent.get<Velocity const>().x + ent.get<Health const>().hp;
+        }
+    }));
+    report("view<3>().each", count, measureWarm(count, [&] {
+        engine.view<Position, Velocity const, Health const>().each(
+            [&](ou::Entity&, Position& pos, Velocity const& vel, Health const&) { pos.x += vel.x; });
+    }));
+
+    g_sink = static_cast<float>(sum);
+}
+
+void benchGetOne(std::size_t count)
+{
+    ou::ECSEngine engine;
+    populate(engine, count);
+    engine.addEntity(ou::Entity{ Marker{ 1 } });
+    int sum = 0;
+
+    report("getOne (entity)", count, measureWarm(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += engine.getOne<Marker const>().value;
+        }
+    }));
+
+    engine.setResource(Marker{ 2 });
+    report("getOne (resource)", count, measureWarm(count, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += engine.getOne<Marker const>().value;
+        }
+    }));
+
+    g_sink = static_cast<float>(sum);
+}
+
+// moves every entity once per fixed step, leaving the other columns alone
+class MoveSystem : public ou::EntitySystem {
+public:
+    MoveSystem()
+    {
+        writes<Position>();
+        reads<Velocity>();
+        runAtFixedStep();
+    }
+
+    void update(ou::ECSEngine& engine, float deltaTime) override
+    {
+        engine.view<Position, Velocity const>().each([=](ou::Entity&, Position& pos, Velocity const& vel) {
+            pos.x += vel.x * deltaTime;
+        });
+    }
+};
+
+void benchRollback(std::size_t count)
+{
+    ou::ECSEngine engine;
+    populate(engine, count);
+    engine.addSystem(std::make_unique<MoveSystem>());
+    engine.setFixedDelta(0.25f);
+    std::size_t steps = 20;
+    // builds the stages and the query of the system
+    engine.update(0.25f);
+
+    report("fixed step", count, measure(count * steps, [&] {
+        for (std::size_t i = 0; i < steps; ++i) {
+            engine.update(0.25f);
+        }
+    }));
+    // fill the ring first, so old copies are being reused as in a long run
+    engine.setRollback(steps / 2);
+    for (std::size_t i = 0; i < steps; ++i) {
+        engine.update(0.25f);
+    }
+    report("fixed step with rollback", count, measure(count * steps, [&] {
+        for (std::size_t i = 0; i < steps; ++i) {
+            engine.update(0.25f);
+        }
+    }));
+    report("rewind", count, measure(count, [&] { engine.rewind(steps / 2 - 1); }));
+}
+
+void benchAddRemoveComponent(std::size_t count)
+{
+    ou::ECSEngine engine;
+    std::vector<ou::EntityId> ids = populate(engine, count);
+
+    report("Entity::addComponent", count, measure(count, [&] {
+        for (ou::EntityId id : ids) {
+            engine.entity(id).addComponent(Marker{ 1 });
+        }
+    }));
+    report("Entity::removeComponent", count, measure(count, [&] {
+        for (ou::EntityId id : ids) {
+            engine.entity(id).removeComponent<Marker>();
+        }
+    }));
+}
+}
+
+int main(int argc, char** argv)
+{
+#ifndef NDEBUG
+    std::fprintf(stderr, "ecs_bench: timings of an unoptimised build mean little, build with -DCMAKE_BUILD_TYPE=Release\n");
+    return 1;
+#endif
+    std::size_t maxCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::printf("%-28s %9s %12s %12s\n", "benchmark", "entities", "ns/op", "allocs/op");
+    for (std::size_t count = 1000; count <= maxCount; count *= 10) {
+        benchAddEntity(count);
+        benchSpawnBatch(count);
+        benchInstantiate(count);
+        benchRemoveEntities(count);
+        benchDespawnIf(count);
+        benchIterate(count);
+        benchGetOne(count);
+        benchAddRemoveComponent(count);
+        benchRollback(count);
+    }
+}
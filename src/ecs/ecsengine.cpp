@@ -1,127 +1,903 @@
 #include "ecsengine.h"
 #include <algorithm>
+#include <cmath>
+#include <exception>
 #include <iostream>
+#include <random>
+#include <thread>
 
 namespace ou {
 
-std::mt19937& ECSEngine::rand()
+constexpr float ECSEngine::MaxFrameDelta;
+
+RandomStream ECSEngine::random(EntityId id, std::uint16_t purpose) const
+{
+    // the counter holds the low half of the tick, the high half goes to the key
+    return RandomStream(m_seed ^ (m_ticks & 0xFFFFFFFF00000000), id.index, id.generation,
+        static_cast<std::uint32_t>(m_ticks), purpose);
+}
+
+void ECSEngine::setSeed(std::uint64_t seed)
+{
+    m_seed = seed;
+}
+
+std::uint64_t ECSEngine::seed() const
 {
-    return m_gen;
+    return m_seed;
+}
+
+std::uint64_t ECSEngine::version()
+{
+    // within a stage other systems may be stamping rows, and those writing
+    // what the caller reads run in other stages anyway; outside one the
+    // version can move on, so later writes are told from what was seen
+    if (!m_running.empty()) {
+        return m_version;
+    }
+    return m_version++;
 }
 
 ECSEngine::ECSEngine()
-    : m_entities{}
+    : m_archetypes{}
+    , m_pool(std::make_unique<ThreadPool>(std::max(std::thread::hardware_concurrency(), 1u) - 1))
 {
+    std::random_device device;
+    m_seed = (std::uint64_t(device()) << 32) | device();
 }
 
-void ECSEngine::addEntity(Entity&& entity)
+Archetype* ECSEngine::findArchetype(Signature const& signature) const
 {
-    m_entities.push_back(std::move(entity));
-    ListIter it = std::prev(m_entities.end());
-    m_entities.back().added(this, it);
-    for (auto const& comp : m_entities.back().components()) {
-        m_mappings[comp.first].insert(it);
+    auto it = m_archetypesBySignature.find(signature);
+    return it != m_archetypesBySignature.end() ? it->second : nullptr;
+}
+
+Archetype& ECSEngine::createArchetype(Archetype::Columns&& columns, std::vector<ComponentId>&& tags)
+{
+    m_archetypes.push_back(std::make_unique<Archetype>(std::move(columns), std::move(tags), m_records, m_version));
+    Archetype* ptr = m_archetypes.back().get();
+    m_archetypesBySignature.emplace(ptr->signature(), ptr);
+
+    std::lock_guard<std::mutex> lock(m_queriesMutex);
+    for (auto const& query : m_queries) {
+        if (query && query->matches(*ptr)) {
+            query->add(*ptr);
+        }
     }
+    return *ptr;
 }
 
-void ECSEngine::removeEntities(ECSEngine::Iterator first, ECSEngine::Iterator last, std::function<bool(Entity&)> pred)
+Query* ECSEngine::findQuery(std::size_t key)
 {
-    Iterator it = first;
-    for (; it != last;) {
-        if (!pred(*it)) {
-            ++it;
-            continue;
+    std::lock_guard<std::mutex> lock(m_queriesMutex);
+    return key < m_queries.size() ? m_queries[key].get() : nullptr;
+}
+
+Query& ECSEngine::addQuery(std::size_t key, Signature const& signature)
+{
+    std::lock_guard<std::mutex> lock(m_queriesMutex);
+    if (key >= m_queries.size()) {
+        m_queries.resize(key + 1);
+    }
+    auto& query = m_queries[key];
+    if (!query) {
+        query = std::make_unique<Query>(signature);
+        for (auto const& archetype : m_archetypes) {
+            if (query->matches(*archetype)) {
+                query->add(*archetype);
+            }
+        }
+    }
+    return *query;
+}
+
+EntityId ECSEngine::createId()
+{
+    EntityId id;
+    if (m_freeIndices.empty()) {
+        id.index = static_cast<std::uint32_t>(m_records.size());
+        m_records.emplace_back();
+    } else {
+        id.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    id.generation = m_records[id.index].generation;
+    return id;
+}
+
+EntityRecord const& ECSEngine::record(EntityId id) const
+{
+    if (!alive(id)) {
+        throw std::runtime_error("Stale entity handle");
+    }
+    return m_records[id.index];
+}
+
+void ECSEngine::releaseId(EntityId id)
+{
+    EntityRecord& rec = m_records[id.index];
+    rec.archetype = nullptr;
+    ++rec.generation;
+    m_freeIndices.push_back(id.index);
+}
+
+void ECSEngine::destroy(Archetype& archetype, std::size_t row)
+{
+    recordEvents(archetype, row, row + 1, false);
+    releaseId(archetype.entity(row).id());
+    archetype.swapRemove(row);
+    --m_entityCount;
+}
+
+void ECSEngine::destroyRows(Archetype& archetype, std::vector<std::size_t> const& rows)
+{
+    for (std::size_t row : rows) {
+        recordEvents(archetype, row, row + 1, false);
+        releaseId(archetype.entity(row).id());
+    }
+    archetype.removeRows(rows.data(), rows.size());
+    m_entityCount -= rows.size();
+}
+
+bool ECSEngine::alive(EntityId id) const
+{
+    return id.index < m_records.size()
+        && m_records[id.index].generation == id.generation
+        && m_records[id.index].archetype;
+}
+
+Entity& ECSEngine::entity(EntityId id)
+{
+    EntityRecord const& rec = record(id);
+    return rec.archetype->entity(rec.row);
+}
+
+void ECSEngine::removeEntity(EntityId id)
+{
+    EntityRecord const& rec = record(id);
+    destroy(*rec.archetype, rec.row);
+}
+
+// the signature of the components, or an empty one if a type appears twice
+static Signature signatureOf(Component const* components, std::size_t count)
+{
+    Signature signature;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (signature.test(components[i].id())) {
+            return Signature();
+        }
+        signature.set(components[i].id());
+    }
+    return signature;
+}
+
+Archetype& ECSEngine::archetypeFor(Component const* components, std::size_t count)
+{
+    Signature signature = signatureOf(components, count);
+    if (signature.count() != count) {
+        throw std::runtime_error("Duplicate component");
+    }
+
+    Archetype* archetype = findArchetype(signature);
+    if (!archetype) {
+        Archetype::Columns columns;
+        std::vector<ComponentId> tags;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (components[i].isTag()) {
+                tags.push_back(components[i].id());
+            } else {
+                columns.push_back(components[i].makeColumn());
+            }
+        }
+        archetype = &createArchetype(std::move(columns), std::move(tags));
+    }
+    return *archetype;
+}
+
+bool ECSEngine::matchesArchetype(Archetype& archetype, Component const* components, std::size_t count) const
+{
+    return count == archetype.signature().count() && signatureOf(components, count) == archetype.signature();
+}
+
+EntityId ECSEngine::insert(Archetype& archetype, Component* components, std::size_t count, Entity&& entity)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!components[i].isTag()) {
+            components[i].moveInto(archetype.column(components[i].id()));
+        }
+    }
+    entity.m_engine = this;
+    entity.m_id = createId();
+
+    EntityId id = entity.m_id;
+    archetype.push(std::move(entity));
+    ++m_entityCount;
+    recordEvents(archetype, archetype.size() - 1, archetype.size(), true);
+    return id;
+}
+
+EntityId ECSEngine::addEntity(Entity&& entity)
+{
+    std::vector<Component> components = std::move(entity.m_components);
+    entity.m_components.clear();
+    return insert(archetypeFor(components.data(), components.size()),
+        components.data(), components.size(), std::move(entity));
+}
+
+static Component const* findComponent(Component const* components, std::size_t count, ComponentId id)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        if (components[i].id() == id) {
+            return &components[i];
+        }
+    }
+    return nullptr;
+}
+
+void ECSEngine::spawnCopies(Archetype& archetype, std::size_t count, Component const* const* values,
+    std::size_t stride, std::vector<EntityId>* ids)
+{
+    // grown geometrically, so that many small batches stay linear
+    archetype.grow(count);
+    if (count > m_freeIndices.size()) {
+        std::size_t records = m_records.size() + count - m_freeIndices.size();
+        if (records > m_records.capacity()) {
+            m_records.reserve(std::max(records, 2 * m_records.capacity()));
+        }
+    }
+    Archetype::Columns const& columns = archetype.columns();
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        // rows sharing a value get it in one go
+        for (std::size_t row = 0; row < count;) {
+            Component const* value = values[row * stride + c];
+            std::size_t end = row + 1;
+            while (end < count && values[end * stride + c] == value) {
+                ++end;
+            }
+            value->copyInto(*columns[c], end - row);
+            row = end;
+        }
+    }
+
+    if (ids) {
+        ids->reserve(ids->size() + count);
+    }
+    std::size_t begin = archetype.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        Entity entity;
+        entity.m_engine = this;
+        entity.m_id = createId();
+        if (ids) {
+            ids->push_back(entity.m_id);
+        }
+        archetype.push(std::move(entity));
+    }
+    m_entityCount += count;
+    recordEvents(archetype, begin, archetype.size(), true);
+}
+
+std::vector<EntityId> ECSEngine::spawnBatch(std::size_t count, Entity const& prototype)
+{
+    if (prototype.m_engine) {
+        throw std::runtime_error("Prototype belongs to an engine");
+    }
+    std::vector<Component> const& components = prototype.m_components;
+    Archetype& archetype = archetypeFor(components.data(), components.size());
+
+    std::vector<Component const*> values;
+    for (auto const& column : archetype.columns()) {
+        values.push_back(findComponent(components.data(), components.size(), column->componentId()));
+    }
+    std::vector<EntityId> ids;
+    spawnCopies(archetype, count, values.data(), 0, &ids);
+    return ids;
+}
+
+PrefabId ECSEngine::addPrefab(Entity&& prototype)
+{
+    if (prototype.m_engine) {
+        throw std::runtime_error("Prototype belongs to an engine");
+    }
+    std::vector<Component> components = std::move(prototype.m_components);
+    prototype.m_components.clear();
+
+    Prefab prefab;
+    prefab.archetype = &archetypeFor(components.data(), components.size());
+    std::vector<Component const*> values;
+    for (auto const& column : prefab.archetype->columns()) {
+        values.push_back(findComponent(components.data(), components.size(), column->componentId()));
+    }
+    for (Component const* value : values) {
+        prefab.defaults.push_back(std::move(components[value - components.data()]));
+    }
+    m_prefabs.push_back(std::move(prefab));
+    return PrefabId{ static_cast<std::uint32_t>(m_prefabs.size() - 1) };
+}
+
+std::vector<EntityId> ECSEngine::instantiate(PrefabId prefab, std::size_t count, Entity const& overrides)
+{
+    if (overrides.m_engine) {
+        throw std::runtime_error("Overrides belong to an engine");
+    }
+    m_instanceValues.clear();
+    Prefab const& found = instanceValues(prefab, overrides.m_components.data(), overrides.m_components.size(),
+        m_instanceValues);
+    std::vector<EntityId> ids;
+    spawnCopies(*found.archetype, count, m_instanceValues.data(), 0, &ids);
+    return ids;
+}
+
+ECSEngine::Prefab const& ECSEngine::instanceValues(PrefabId id, Component const* overrides, std::size_t overrideCount,
+    std::vector<Component const*>& values) const
+{
+    if (id.index >= m_prefabs.size()) {
+        throw std::runtime_error("Prefab does not exist");
+    }
+    Prefab const& prefab = m_prefabs[id.index];
+
+    std::size_t begin = values.size();
+    for (Component const& value : prefab.defaults) {
+        values.push_back(&value);
+    }
+    for (std::size_t i = 0; i < overrideCount; ++i) {
+        if (!prefab.archetype->has(overrides[i].id())) {
+            throw std::runtime_error("Override is not a component of the prefab");
+        }
+        for (std::size_t c = 0; c < prefab.defaults.size(); ++c) {
+            if (prefab.defaults[c].id() == overrides[i].id()) {
+                values[begin + c] = &overrides[i];
+            }
+        }
+    }
+    return prefab;
+}
+
+CommandBuffer& ECSEngine::commands()
+{
+    std::thread::id thread = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(m_commandsMutex);
+    for (auto const& pair : m_commandBuffers) {
+        if (pair.first == thread) {
+            return *pair.second;
+        }
+    }
+    m_commandBuffers.emplace_back(thread, std::make_unique<CommandBuffer>());
+    return *m_commandBuffers.back().second;
+}
+
+void ECSEngine::flushCommands()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandsMutex);
+        for (auto& pair : m_commandBuffers) {
+            if (!pair.second->empty()) {
+                playback(*pair.second);
+            }
+        }
+    }
+    // outside the lock, so hooks can record commands
+    notifyObservers();
+}
+
+void ECSEngine::dropCommands()
+{
+    std::lock_guard<std::mutex> lock(m_commandsMutex);
+    for (auto const& pair : m_commandBuffers) {
+        pair.second->clear();
+    }
+}
+
+void ECSEngine::playback(CommandBuffer& buffer)
+{
+    // the buffer is emptied even if a command throws, so what was applied
+    // is not applied again by the next flush
+    struct Clear {
+        CommandBuffer& buffer;
+        ~Clear() { buffer.clear(); }
+    } clear{ buffer };
+
+    auto added = buffer.m_added.begin();
+    for (auto const& change : buffer.m_changes) {
+        if (change.add) {
+            Component& component = *added++;
+            if (alive(change.id)) {
+                addComponent(change.id, std::move(component));
+            }
+        } else if (alive(change.id) && record(change.id).archetype->has(change.component)) {
+            removeComponent(change.id, change.component);
+        }
+    }
+
+    for (EntityId id : buffer.m_destroys) {
+        if (alive(id)) {
+            removeEntity(id);
+        }
+    }
+
+    // consecutive spawns usually share a shape, so look the archetype up once
+    // per run and grow its columns in one go
+    Component* components = buffer.m_spawned.data();
+    auto const& sizes = buffer.m_spawnSizes;
+    for (std::size_t i = 0; i < sizes.size();) {
+        Archetype& archetype = archetypeFor(components, sizes[i]);
+        std::size_t run = i + 1;
+        for (Component* next = components + sizes[i];
+             run < sizes.size() && matchesArchetype(archetype, next, sizes[run]); next += sizes[run++]) {
+        }
+
+        archetype.grow(run - i);
+        for (; i < run; components += sizes[i++]) {
+            insert(archetype, components, sizes[i], Entity{});
         }
-        auto list_iter = *it.it;
-        bool incremented = false;
-        for (auto const& comp : it->components()) {
-            auto& mapping = m_mappings[comp.first];
-            auto found = mapping.find(list_iter);
-            if (comp.first != it.prime_key) {
-                mapping.erase(found);
+    }
+
+    // consecutive instances of a prefab are added in one go, each with its
+    // own overrides
+    Component const* overrides = buffer.m_overrides.data();
+    auto const& instances = buffer.m_instances;
+    for (std::size_t i = 0; i < instances.size();) {
+        m_instanceValues.clear();
+        Prefab const* prefab = nullptr;
+        std::size_t run = i;
+        for (; run < instances.size() && instances[run].prefab.index == instances[i].prefab.index; ++run) {
+            prefab = &instanceValues(instances[run].prefab, overrides, instances[run].overrides, m_instanceValues);
+            overrides += instances[run].overrides;
+        }
+        spawnCopies(*prefab->archetype, run - i, m_instanceValues.data(), prefab->defaults.size(), nullptr);
+        i = run;
+    }
+}
+
+void ECSEngine::addComponent(EntityId id, Component&& component)
+{
+    ComponentId added = component.id();
+    EntityRecord const& rec = record(id);
+    Archetype& src = *rec.archetype;
+    if (src.has(added)) {
+        return;
+    }
+
+    Archetype* dst = src.addEdge(added);
+    if (!dst) {
+        Signature signature = src.signature();
+        dst = findArchetype(signature.set(added));
+        if (!dst) {
+            Archetype::Columns columns = src.cloneEmptyColumns();
+            std::vector<ComponentId> tags = src.tags();
+            if (component.isTag()) {
+                tags.push_back(added);
             } else {
-                it.it = mapping.erase(found);
-                it.moveToNext();
-                incremented = true;
+                columns.push_back(component.makeColumn());
             }
+            dst = &createArchetype(std::move(columns), std::move(tags));
+        }
+        src.setAddEdge(added, dst);
+        dst->setRemoveEdge(added, &src);
+    }
+
+    if (!component.isTag()) {
+        component.moveInto(dst->column(added));
+    }
+    src.moveRowTo(rec.row, *dst);
+    recordEvent(id, added, true);
+}
+
+void ECSEngine::removeComponent(EntityId id, ComponentId removed)
+{
+    EntityRecord const& rec = record(id);
+    Archetype& src = *rec.archetype;
+    if (src.has(removed)) {
+        recordEvent(id, removed, false);
+    }
+
+    Archetype* dst = src.removeEdge(removed);
+    if (!dst) {
+        Signature signature = src.signature();
+        dst = findArchetype(signature.reset(removed));
+        if (!dst) {
+            Archetype::Columns columns = src.cloneEmptyColumns();
+            columns.erase(std::remove_if(columns.begin(), columns.end(),
+                              [&](std::unique_ptr<ColumnBase> const& column) { return column->componentId() == removed; }),
+                columns.end());
+            std::vector<ComponentId> tags = src.tags();
+            tags.erase(std::remove(tags.begin(), tags.end(), removed), tags.end());
+            dst = &createArchetype(std::move(columns), std::move(tags));
         }
-        if (!incremented) {
+        src.setRemoveEdge(removed, dst);
+        dst->setAddEdge(removed, &src);
+    }
+
+    src.moveRowTo(rec.row, *dst);
+}
+
+void ECSEngine::removeEntities(ECSEngine::Iterator first, ECSEngine::Iterator last, std::function<bool(Entity&)> pred)
+{
+    Iterator it = first;
+    while (it != last) {
+        if (!pred(*it)) {
             ++it;
+            continue;
         }
-        m_entities.erase(list_iter);
+        // the last row of the archetype takes the place of the removed one
+        destroy(*(*it.archetypes)[it.archetype], it.row);
+        it.moveToNext();
     }
 }
 
 std::size_t ECSEngine::countEntity() const
 {
-    return m_entities.size();
+    return m_entityCount;
 }
 
 void ECSEngine::addSystem(std::unique_ptr<EntitySystem>&& system, int priority)
 {
+    m_profiler.add(*system);
+    placeSystem(*system);
     m_systems.insert({ priority, std::move(system) });
+    m_stagesDirty = true;
 }
 
-void ECSEngine::update(float deltaTime)
+// a system goes to the stage after the last earlier system it conflicts with
+static std::vector<std::vector<EntitySystem*>> makeStages(std::vector<EntitySystem*> const& systems)
+{
+    std::vector<std::vector<EntitySystem*>> stages;
+    std::vector<std::size_t> stageOf;
+
+    for (std::size_t i = 0; i < systems.size(); ++i) {
+        std::size_t stage = 0;
+        for (std::size_t j = 0; j < i; ++j) {
+            if (systems[j]->conflictsWith(*systems[i])) {
+                stage = std::max(stage, stageOf[j] + 1);
+            }
+        }
+
+        stageOf.push_back(stage);
+        if (stage == stages.size()) {
+            stages.emplace_back();
+        }
+        stages[stage].push_back(systems[i]);
+    }
+    return stages;
+}
+
+void ECSEngine::buildStages()
 {
+    // m_systems is in priority order, so the systems before the first
+    // fixed-step one are those that run before the ticks
+    std::vector<EntitySystem*> early;
+    std::vector<EntitySystem*> fixed;
+    std::vector<EntitySystem*> late;
     for (auto const& pair : m_systems) {
-        pair.second->update(*this, deltaTime);
+        EntitySystem* system = pair.second.get();
+        if (system->isFixedStep()) {
+            fixed.push_back(system);
+        } else {
+            (fixed.empty() ? early : late).push_back(system);
+        }
+    }
+    // without ticks there is nothing to run around
+    if (fixed.empty()) {
+        early.swap(late);
+    }
+
+    m_earlyStages = makeStages(early);
+    m_fixedStages = makeStages(fixed);
+    m_stages = makeStages(late);
+
+    // the fixed delta may have changed since the systems were placed
+    for (EntitySystem* system : fixed) {
+        if (system->m_rate > 0) {
+            system->m_interval = std::max<std::uint64_t>(1, std::llround(1 / (m_fixedDelta * system->m_rate)));
+            system->m_phase = static_cast<std::uint64_t>(std::llround(system->m_interval * system->m_offset))
+                % system->m_interval;
+        }
+    }
+    m_stagesDirty = false;
+}
+
+// Systems sharing a rate start at different points of their period, so they
+// are not all due in the same frame or tick. The points go 0, 1/2, 1/4, 3/4,
+// 1/8... in order of addition, which spreads any number of systems fairly
+// evenly without moving those added before.
+void ECSEngine::placeSystem(EntitySystem& system)
+{
+    system.m_elapsed = 0;
+    system.m_started = false;
+    system.m_addedTick = m_ticks;
+    if (system.m_rate <= 0) {
+        return;
+    }
+
+    std::size_t index = 0;
+    for (auto const& pair : m_systems) {
+        EntitySystem const& other = *pair.second;
+        if (other.m_rate == system.m_rate && other.isFixedStep() == system.isFixedStep()) {
+            ++index;
+        }
+    }
+    float offset = 0;
+    for (float bit = 0.5f; index > 0; index >>= 1, bit /= 2) {
+        if (index & 1) {
+            offset += bit;
+        }
+    }
+    system.m_offset = offset;
+    system.m_due = offset / system.m_rate;
+}
+
+bool ECSEngine::isDue(EntitySystem& system, float deltaTime, bool fixed)
+{
+    if (system.m_rate <= 0) {
+        system.m_deltaTime = deltaTime;
+        return true;
+    }
+    if (fixed) {
+        // decided by the tick alone, so resimulated ticks run the same systems;
+        // the first update only covers the ticks since the system was added
+        std::uint64_t ticks = m_ticks >= system.m_addedTick ? m_ticks - system.m_addedTick + 1 : system.m_interval;
+        system.m_deltaTime = deltaTime * std::min(ticks, system.m_interval);
+        return (m_ticks + system.m_phase) % system.m_interval == 0;
+    }
+
+    system.m_elapsed += deltaTime;
+    system.m_due -= deltaTime;
+    if (system.m_due > 0) {
+        return false;
+    }
+    system.m_deltaTime = system.m_started ? system.m_elapsed : std::min(system.m_elapsed, 1 / system.m_rate);
+    system.m_started = true;
+    system.m_elapsed = 0;
+    // after a stall the updates missed are skipped rather than caught up on
+    system.m_due += 1 / system.m_rate;
+    if (system.m_due <= 0) {
+        system.m_due = 1 / system.m_rate;
+    }
+    return true;
+}
+
+void ECSEngine::updateSystem(EntitySystem& system)
+{
+    Profiler::Scope scope(m_profiler.stats(system).update);
+    system.update(*this, system.m_deltaTime);
+}
+
+void ECSEngine::runStage(std::vector<EntitySystem*> const& stage)
+{
+    if (stage.size() == 1 || m_deterministic) {
+        for (EntitySystem* system : stage) {
+            updateSystem(*system);
+        }
+        return;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for (EntitySystem* system : stage) {
+        if (!system->isMainThreadOnly()) {
+            tasks.push_back([this, system] { updateSystem(*system); });
+        }
+    }
+    auto batch = m_pool->start(std::move(tasks));
+
+    std::exception_ptr error;
+    for (EntitySystem* system : stage) {
+        if (system->isMainThreadOnly()) {
+            try {
+                updateSystem(*system);
+            } catch (...) {
+                error = std::current_exception();
+                break;
+            }
+        }
+    }
+
+    m_pool->wait(*batch);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ECSEngine::runStages(std::vector<std::vector<EntitySystem*>> const& stages, float deltaTime, bool fixed)
+{
+    for (auto const& stage : stages) {
+        m_running.clear();
+        for (EntitySystem* system : stage) {
+            if (isDue(*system, deltaTime, fixed)) {
+                m_running.push_back(system);
+            }
+        }
+        if (m_running.empty()) {
+            continue;
+        }
+        ++m_version;
+        runStage(m_running);
+        m_running.clear();
+        flushCommands();
+    }
+}
+
+void ECSEngine::fixedStep()
+{
+    runStages(m_fixedStages, m_fixedDelta, true);
+    ++m_ticks;
+    if (m_rollback.capacity() > 0) {
+        capture();
+    }
+}
+
+void ECSEngine::capture()
+{
+    m_rollback.capture(m_ticks, m_version, m_archetypes, m_records, m_freeIndices);
+    // later changes must be told apart from what was just copied
+    ++m_version;
+}
+
+void ECSEngine::setRollback(std::size_t ticks, std::size_t maxBytes)
+{
+    m_rollback.setCapacity(ticks, maxBytes);
+    if (ticks == 0) {
+        m_rollback.clear();
+    } else if (m_rollback.size() == 0 || m_rollback.newestTick() != m_ticks) {
+        capture();
+    }
+}
+
+std::uint64_t ECSEngine::rewindableTicks() const
+{
+    return m_rollback.size() > 0 ? m_ticks - m_rollback.oldestTick() : 0;
+}
+
+std::size_t ECSEngine::rollbackBytes() const
+{
+    return m_rollback.bytes();
+}
+
+void ECSEngine::rewind(std::uint64_t ticks)
+{
+    if (ticks > rewindableTicks()) {
+        throw std::runtime_error("Cannot rewind that far");
+    }
+    dropCommands();
+
+    m_rewoundFrom = std::max(m_rewoundFrom, m_ticks);
+    m_ticks -= ticks;
+    // the restored rows count as changed
+    ++m_version;
+    recordAllEvents(false);
+    m_entityCount = m_rollback.restore(m_ticks, *this, m_archetypes, m_records, m_freeIndices);
+    recordAllEvents(true);
+}
+
+void ECSEngine::resimulate()
+{
+    if (m_stagesDirty) {
+        buildStages();
+    }
+    while (m_ticks < m_rewoundFrom) {
+        fixedStep();
     }
+    m_rewoundFrom = 0;
+}
+
+void ECSEngine::update(float deltaTime)
+{
+    if (m_stagesDirty) {
+        buildStages();
+    }
+
+    runStages(m_earlyStages, deltaTime, false);
+
+    // after a long stall only catch up on a limited amount of time, so the
+    // ticks needed to do so cannot stall the next frame even more
+    m_accumulator += std::min(deltaTime, MaxFrameDelta);
+    while (m_accumulator >= m_fixedDelta) {
+        m_accumulator -= m_fixedDelta;
+        fixedStep();
+    }
+
+    runStages(m_stages, deltaTime, false);
+    ++m_version;
     for (auto const& pair : m_systems) {
+        Profiler::Scope scope(m_profiler.stats(*pair.second).afterUpdate);
         pair.second->afterUpdate(*this);
     }
+    flushCommands();
+
+    ++m_frames;
+    if (m_profileOut && m_frames % m_profileEvery == 0) {
+        m_profiler.dump(*m_profileOut);
+    }
+}
+
+void ECSEngine::setFixedDelta(float seconds)
+{
+    if (seconds <= 0) {
+        throw std::runtime_error("Fixed delta must be positive");
+    }
+    m_fixedDelta = seconds;
+    // the tick intervals of systems with a rate depend on it
+    m_stagesDirty = true;
+}
+
+float ECSEngine::fixedDelta() const
+{
+    return m_fixedDelta;
+}
+
+float ECSEngine::interpolation() const
+{
+    return m_accumulator / m_fixedDelta;
+}
+
+std::uint64_t ECSEngine::ticks() const
+{
+    return m_ticks;
+}
+
+ThreadPool& ECSEngine::threadPool()
+{
+    return *m_pool;
+}
+
+Profiler const& ECSEngine::profiler() const
+{
+    return m_profiler;
+}
+
+void ECSEngine::setProfileDump(std::ostream* out, std::uint64_t frames)
+{
+    if (out && !frames) {
+        throw std::runtime_error("Profile dump interval must be positive");
+    }
+    m_profileOut = out;
+    m_profileEvery = frames;
 }
 
-ECSEngine::Range::Range(ECSEngine* engine, std::vector<std::type_index>&& keys)
+void ECSEngine::setDeterministic(bool deterministic)
 {
-    std::type_index prime_key = *std::min_element(keys.begin(), keys.end(),
-        [&](std::type_index t1, std::type_index t2) {
-            return engine->m_mappings[t1].size() < engine->m_mappings[t2].size();
-        });
+    m_deterministic = deterministic;
+}
 
-    keys.erase(std::remove(keys.begin(), keys.end(), prime_key), keys.end());
+bool ECSEngine::isDeterministic() const
+{
+    return m_deterministic;
+}
 
-    auto& map = engine->m_mappings[prime_key];
-    m_begin = Iterator(map.begin(), map.end(), prime_key, keys);
-    m_end = Iterator(map.end(), map.end(), prime_key, keys);
+ECSEngine::Range::Range(Query const& query)
+    : m_archetypes(&query.archetypes())
+{
 }
 
-ECSEngine::Iterator ECSEngine::Range::begin()
+ECSEngine::Iterator ECSEngine::Range::begin() const
 {
-    return m_begin;
+    return Iterator(m_archetypes, 0);
 }
 
-ECSEngine::Iterator ECSEngine::Range::end()
+ECSEngine::Iterator ECSEngine::Range::end() const
 {
-    return m_end;
+    return Iterator(m_archetypes, m_archetypes->size());
 }
 
-ECSEngine::Iterator::Iterator(MappingIter it, MappingIter end, std::type_index prime_key,
-    const std::vector<std::type_index>& other_keys)
-    : it(it)
-    , end(end)
-    , prime_key(prime_key)
-    , other_keys(other_keys)
+ECSEngine::Iterator::Iterator(std::vector<Archetype*> const* archetypes, std::size_t archetype)
+    : archetypes(archetypes)
+    , archetype(archetype)
 {
     moveToNext();
 }
 
 void ECSEngine::Iterator::moveToNext()
 {
-    if (other_keys.size() > 0) {
-        it = std::find_if(it, end, [&](ListIter it) {
-            return std::all_of(other_keys.begin(), other_keys.end(),
-                [&](std::type_index type) { return it->has(type); });
-        });
+    while (archetype < archetypes->size() && row >= (*archetypes)[archetype]->size()) {
+        ++archetype;
+        row = 0;
     }
 }
 
 ECSEngine::Iterator& ECSEngine::Iterator::operator++()
 {
-    if (it == end) {
+    if (archetype == archetypes->size()) {
         throw std::runtime_error("Attempt to increment the past-the-end iterator");
     }
-    ++it;
+    ++row;
     moveToNext();
     return *this;
 }
@@ -135,7 +911,7 @@ ECSEngine::Iterator ECSEngine::Iterator::operator++(int)
 
 bool ECSEngine::Iterator::operator==(Iterator other) const
 {
-    return it == other.it;
+    return archetype == other.archetype && row == other.row;
 }
 
 bool ECSEngine::Iterator::operator!=(Iterator other) const
@@ -145,7 +921,7 @@ bool ECSEngine::Iterator::operator!=(Iterator other) const
 
 Entity& ECSEngine::Iterator::operator*() const
 {
-    return **it;
+    return (*archetypes)[archetype]->entity(row);
 }
 
 Entity* ECSEngine::Iterator::operator->() const
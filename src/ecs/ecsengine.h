@@ -1,16 +1,35 @@
 #ifndef ECSENGINE_H
 #define ECSENGINE_H
 
+#include "archetype.h"
+#include "commandbuffer.h"
+#include "componentregistry.h"
 #include "entity.h"
 #include "entitysystem.h"
+#include "profiler.h"
+#include "query.h"
+#include "random.h"
+#include "rollback.h"
+#include "threadpool.h"
+#include "typefamily.h"
+#include "view.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
-#include <list>
+#include <iosfwd>
+#include <iterator>
 #include <map>
-#include <random>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <tuple>
-#include <unordered_set>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace ou {
@@ -18,33 +37,158 @@ namespace ou {
 class ECSEngine {
     friend class Entity;
 
-    using ListIter = std::list<Entity>::iterator;
+    // in order of creation
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::unordered_map<Signature, Archetype*> m_archetypesBySignature;
+    std::vector<EntityRecord> m_records;
 
-    struct ListIterHash {
-        size_t operator()(ListIter it) const
-        {
-            return std::hash<Entity*>{}(&*it);
-        }
-    };
-    using Mapping = std::unordered_set<ListIter, ListIterHash>;
-    using MappingIter = Mapping::iterator;
+    // indexed by TypeFamily::id of the resource type
+    std::vector<std::unique_ptr<void, void (*)(void*)>> m_resources;
 
-    std::list<Entity> m_entities;
-    std::unordered_map<std::type_index, Mapping> m_mappings;
+    // indexed by TypeFamily::id of std::tuple<Ts...> of the types asked for
+    std::vector<std::unique_ptr<Query>> m_queries;
+    std::mutex m_queriesMutex;
+    std::vector<std::uint32_t> m_freeIndices;
+    std::size_t m_entityCount = 0;
+
+    // advanced before every stage of update; rows remember the version at
+    // which they were last changed
+    std::uint64_t m_version = 1;
     std::multimap<int, std::unique_ptr<EntitySystem>, std::greater<>> m_systems;
 
-    std::mt19937 m_gen{ std::random_device{}() };
+    // the ticks run where the fixed-step system of highest priority would,
+    // between the variable systems of higher priority and the rest
+    std::vector<std::vector<EntitySystem*>> m_earlyStages;
+    std::vector<std::vector<EntitySystem*>> m_fixedStages;
+    std::vector<std::vector<EntitySystem*>> m_stages;
+    bool m_stagesDirty = true;
+    // the systems of the stage being run that are due, empty between stages
+    std::vector<EntitySystem*> m_running;
+    bool m_deterministic = false;
+
+    float m_fixedDelta = 1.0f / 60;
+    float m_accumulator = 0;
+    std::uint64_t m_ticks = 0;
+    static constexpr float MaxFrameDelta = 0.25f;
+
+    // parallelEach hands out chunks of about this many bytes of component data
+    static constexpr std::size_t ChunkBytes = 16 * 1024;
+
+    std::uint64_t m_seed;
+
+    ComponentRegistry m_registry;
+
+    // Entities added from a prefab go to an archetype found once, with copies
+    // of the defaults, which are kept in the order of its columns.
+    struct Prefab {
+        Archetype* archetype;
+        std::vector<Component> defaults;
+    };
+    std::vector<Prefab> m_prefabs;
+    // the values instances are copied from, kept between calls
+    std::vector<Component const*> m_instanceValues;
+
+    // Hooks of one component type, and what happened to the type since they
+    // were last called
+    struct Observers {
+        std::vector<std::function<void(ECSEngine&, std::vector<EntityId> const&)>> added, removed, changed;
+        // entities that gained (true) or lost the type, in order
+        std::vector<std::pair<EntityId, bool>> events;
+        // changes up to this version have been reported
+        std::uint64_t reported = 0;
+    };
+    // indexed by component id
+    std::vector<Observers> m_observers;
+    // types with hooks on add or remove, whose events are recorded
+    std::vector<ComponentId> m_observedTypes;
+    bool m_notifying = false;
+
+    Rollback m_rollback;
+    // the tick rewind was first called at since the last resimulate
+    std::uint64_t m_rewoundFrom = 0;
+
+    std::mutex m_commandsMutex;
+    // in order of first use by their threads, which is the order they are
+    // played back in, rather than in whatever order a hash map has them
+    std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> m_commandBuffers;
+
+    std::unique_ptr<ThreadPool> m_pool;
+
+    Profiler m_profiler;
+    std::ostream* m_profileOut = nullptr;
+    std::uint64_t m_profileEvery = 0;
+    std::uint64_t m_frames = 0;
+
+    Archetype* findArchetype(Signature const& signature) const;
+    Archetype& createArchetype(Archetype::Columns&& columns, std::vector<ComponentId>&& tags);
+    Query* findQuery(std::size_t key);
+    Query& addQuery(std::size_t key, Signature const& signature);
+
+    Archetype& archetypeFor(Component const* components, std::size_t count);
+    bool matchesArchetype(Archetype& archetype, Component const* components, std::size_t count) const;
+    EntityId insert(Archetype& archetype, Component* components, std::size_t count, Entity&& entity);
+    void playback(CommandBuffer& buffer);
+    // drops the pending commands of every thread
+    void dropCommands();
+
+    EntityId createId();
+    void releaseId(EntityId id);
+    EntityRecord const& record(EntityId id) const;
+    void destroy(Archetype& archetype, std::size_t row);
+    void destroyRows(Archetype& archetype, std::vector<std::size_t> const& rows);
+    // Row r of the count added gets a copy of values[r * stride + c] in
+    // column c, so with a stride of 0 all rows get the same values.
+    void spawnCopies(Archetype& archetype, std::size_t count, Component const* const* values, std::size_t stride,
+        std::vector<EntityId>* ids);
+    // appends the values of an instance of the prefab in column order
+    Prefab const& instanceValues(PrefabId prefab, Component const* overrides, std::size_t overrideCount,
+        std::vector<Component const*>& values) const;
+    void clearEntities();
+
+    Observers& observers(ComponentId id, bool structural);
+    void recordEvent(EntityId id, ComponentId component, bool added);
+    void recordEvents(Archetype& archetype, std::size_t begin, std::size_t end, bool added);
+    void recordAllEvents(bool added);
+    void notifyObservers();
+
+    void buildStages();
+    void fixedStep();
+    void capture();
+    void placeSystem(EntitySystem& system);
+    bool isDue(EntitySystem& system, float deltaTime, bool fixed);
+    void updateSystem(EntitySystem& system);
+    void runStage(std::vector<EntitySystem*> const& stage);
+    void runStages(std::vector<std::vector<EntitySystem*>> const& stages, float deltaTime, bool fixed);
+
+    template <typename T>
+    T& get(EntityRecord const& rec, std::true_type)
+    {
+        if (!rec.archetype->has(ComponentIds::id<T>())) {
+            throw std::runtime_error("Component does not exist");
+        }
+        return tagInstance<T>();
+    }
+
+    template <typename T>
+    T& get(EntityRecord const& rec, std::false_type)
+    {
+        if (!std::is_const<T>::value) {
+            rec.archetype->column(ComponentIds::id<T>()).touch(rec.row);
+        }
+        return rec.archetype->template data<std::remove_const_t<T>>()[rec.row];
+    }
+
+    void addComponent(EntityId id, Component&& component);
+    void removeComponent(EntityId id, ComponentId component);
 
     class Iterator {
         friend class ECSEngine;
-        MappingIter it;
-        MappingIter end;
-        std::type_index prime_key = typeid(void);
-        std::vector<std::type_index> other_keys;
+        std::vector<Archetype*> const* archetypes = nullptr;
+        std::size_t archetype = 0;
+        std::size_t row = 0;
 
         Iterator() = default;
-        Iterator(MappingIter it, MappingIter end, std::type_index prime_key,
-            std::vector<std::type_index> const& other_keys);
+        Iterator(std::vector<Archetype*> const* archetypes, std::size_t archetype);
         void moveToNext();
 
     public:
@@ -65,19 +209,99 @@ class ECSEngine {
     class Range {
         friend class ECSEngine;
 
-        Iterator m_begin, m_end;
+        std::vector<Archetype*> const* m_archetypes;
 
-        Range(ECSEngine* engine, std::vector<std::type_index>&& keys);
+        explicit Range(Query const& query);
 
     public:
-        Iterator begin();
-        Iterator end();
+        Iterator begin() const;
+        Iterator end() const;
     };
 
 public:
     ECSEngine();
 
-    void addEntity(Entity&& entity);
+    EntityId addEntity(Entity&& entity);
+
+    void removeEntity(EntityId id);
+
+    // Adds count entities with copies of the components of prototype, which
+    // must not belong to an engine, and returns their ids. Storage is reserved
+    // once and each column is filled in one go.
+    std::vector<EntityId> spawnBatch(std::size_t count, Entity const& prototype);
+
+    // Registers a template for entities with the components of prototype as
+    // their default values. The archetype of the entities is found here once
+    // instead of on every instantiate.
+    PrefabId addPrefab(Entity&& prototype);
+
+    // Adds count entities of the prefab and returns their ids. Components of
+    // overrides, which must be types of the prefab, are copied instead of the
+    // defaults. Like spawnBatch, each column is filled in one go.
+    std::vector<EntityId> instantiate(PrefabId prefab, std::size_t count = 1, Entity const& overrides = Entity{});
+
+    // Removes every entity having all of Ts for which pred(Entity&, Ts&...)
+    // returns true, and returns how many were removed. Each archetype is
+    // compacted in a single pass, so the remaining entities keep their order.
+    // Declare types const unless pred changes them.
+    template <typename T0, typename... Ts, typename F>
+    std::size_t despawnIf(F pred)
+    {
+        std::size_t removed = 0;
+        std::vector<std::size_t> rows;
+        for (Archetype* archetype : query<T0, Ts...>().archetypes()) {
+            Entity* entities = archetype->entities();
+            rows.clear();
+            View<T0, Ts...>::each(*archetype, 0, archetype->size(), [&](Entity& ent, auto&&... components) {
+                if (pred(ent, components...)) {
+                    rows.push_back(static_cast<std::size_t>(&ent - entities));
+                }
+            });
+            destroyRows(*archetype, rows);
+            removed += rows.size();
+        }
+        return removed;
+    }
+
+    // Command buffer of the calling thread. Systems use it instead of changing
+    // the structure of the engine directly; the engine applies all buffers
+    // after each stage of update, or when flushCommands is called.
+    CommandBuffer& commands();
+
+    void flushCommands();
+
+    using Observer = std::function<void(ECSEngine&, std::vector<EntityId> const&)>;
+
+    // Hooks for keeping data derived from components of type T up to date.
+    // They are called after the commands are applied at each sync point,
+    // with the ids, in ascending order, of the entities that gained T, lost
+    // it (which may be dead by then), or still have it and had it changed
+    // since the last sync point. An entity that lost T and gained it again in
+    // between is reported as removed and added. Structural changes made by
+    // the hooks are reported at the next sync point.
+    //
+    // "Changed" means mutable access, not a different value: every row a
+    // view with a non-const T visits, and every get<T> or Entity::get<T>
+    // with a non-const T, counts as a change whether or not it wrote. Use
+    // const terms where a system only reads T, or the hooks see every row.
+    template <typename T>
+    void onAdd(Observer observer) { observers(ComponentIds::id<T>(), true).added.push_back(std::move(observer)); }
+
+    template <typename T>
+    void onRemove(Observer observer) { observers(ComponentIds::id<T>(), true).removed.push_back(std::move(observer)); }
+
+    template <typename T>
+    void onChange(Observer observer)
+    {
+        static_assert(!IsTag<T>::value, "Tags do not change");
+        Observers& observed = observers(ComponentIds::id<T>(), false);
+        if (observed.changed.empty()) {
+            // what changed before there was anyone to tell is not reported;
+            // changes from here on are stamped with a later version
+            observed.reported = m_version++;
+        }
+        observed.changed.push_back(std::move(observer));
+    }
 
     void removeEntities(Iterator first, Iterator last, std::function<bool(Entity&)> pred);
 
@@ -97,9 +321,93 @@ public:
 
     std::size_t countEntity() const;
 
+    // Names a component type for snapshots. Tags and trivially copyable types
+    // are saved as they are in memory, others need functions that save and
+    // load one value.
+    template <typename T>
+    void registerComponent(std::string name) { m_registry.add<T>(std::move(name)); }
+
+    template <typename T>
+    void registerComponent(std::string name, void (*save)(T const&, SnapshotWriter&), T (*load)(SnapshotReader&))
+    {
+        m_registry.add<T>(std::move(name), save, load);
+    }
+
+    // Writes every entity to a file, together with the tick count and the
+    // seed, after playing back pending commands. All component types of the
+    // entities must be registered. Resources and systems are not saved.
+    void saveSnapshot(std::string const& path);
+
+    // Replaces every entity with those of a snapshot, under the ids they were
+    // saved with, and restores the tick count and the seed. Pending commands
+    // are dropped. The snapshot must come from the same platform and register
+    // the same names. If it cannot be loaded, nothing is changed.
+    void loadSnapshot(std::string const& path);
+
+    bool alive(EntityId id) const;
+
+    // throws if the handle is stale
+    Entity& entity(EntityId id);
+
+    template <typename T>
+    bool has(EntityId id) const
+    {
+        return alive(id) && record(id).archetype->has(ComponentIds::id<T>());
+    }
+
+    // marks the component as changed unless T is const
+    template <typename T>
+    T& get(EntityId id) { return get<T>(record(id), IsTag<T>{}); }
+
+    template <typename T>
+    void add(EntityId id, T component) { addComponent(id, Component(std::move(component))); }
+
+    template <typename T>
+    void remove(EntityId id)
+    {
+        if (!has<T>(id)) {
+            throw std::runtime_error("Component does not exist");
+        }
+        removeComponent(id, ComponentIds::id<T>());
+    }
+
+    // Stores a single instance of T outside of any entity, replacing the
+    // previous one. The reference stays valid until the resource is replaced.
+    template <typename T>
+    T& setResource(T value)
+    {
+        std::size_t id = TypeFamily::id<T>();
+        while (id >= m_resources.size()) {
+            m_resources.emplace_back(nullptr, nullptr);
+        }
+        m_resources[id] = { new T(std::move(value)), [](void* ptr) { delete static_cast<T*>(ptr); } };
+        return *static_cast<T*>(m_resources[id].get());
+    }
+
+    template <typename T>
+    T* findResource()
+    {
+        std::size_t id = TypeFamily::id<std::remove_const_t<T>>();
+        return id < m_resources.size() ? static_cast<T*>(m_resources[id].get()) : nullptr;
+    }
+
+    template <typename T>
+    T& resource()
+    {
+        T* res = findResource<T>();
+        if (!res) {
+            throw std::runtime_error("No such resource");
+        }
+        return *res;
+    }
+
+    // the resource of type T if there is one, otherwise T of the first entity having it
     template <typename T>
     T& getOne()
     {
+        if (T* res = findResource<T>()) {
+            return *res;
+        }
         Range range = iterate<T>();
         if (range.begin() == range.end()) {
             throw std::runtime_error("No such entity");
@@ -120,12 +428,131 @@ public:
 
     void addSystem(std::unique_ptr<EntitySystem>&& system, int priority = 0);
 
+    // Runs the systems in priority order. Systems whose declared component
+    // accesses do not conflict are run concurrently on the thread pool.
+    // Fixed-step systems run together, once for every whole fixed delta of
+    // time accumulated so far, which may be never or several times per call,
+    // in the place of the one of highest priority: after the other systems
+    // of higher priority and before the rest. Systems with a rate are
+    // skipped until they are due.
     void update(float deltaTime);
 
+    void setFixedDelta(float seconds);
+
+    // Keeps the entities as they were after each of the last ticks fixed
+    // steps, using at most about maxBytes for copies, so rewind can go back to
+    // them. Each step copies only the columns written during it. 0 turns
+    // rollback off.
+    void setRollback(std::size_t ticks, std::size_t maxBytes = SIZE_MAX);
+
+    // how many ticks rewind can go back at the moment
+    std::uint64_t rewindableTicks() const;
+
+    // memory taken by the copies kept for rewind
+    std::size_t rollbackBytes() const;
+
+    // Puts the entities back as they were the given number of ticks ago and
+    // sets the tick count back accordingly. Resources are not rolled back,
+    // and pending commands are dropped.
+    void rewind(std::uint64_t ticks);
+
+    // Runs the fixed-step systems again until the tick count is back where it
+    // was before rewind. Random streams give the same numbers as the first
+    // time, so unless something was changed in between, the same state
+    // results.
+    void resimulate();
+    float fixedDelta() const;
+
+    // How far the time since the last fixed step is into the next one, in
+    // [0, 1), for interpolating between the states of the last two steps.
+    float interpolation() const;
+
+    // number of fixed steps run so far
+    std::uint64_t ticks() const;
+
+    ThreadPool& threadPool();
+
+    // Time, call counts and heap allocations of every system's update and
+    // afterUpdate, over the last RollingHistogram::Window calls
+    Profiler const& profiler() const;
+
+    // Writes the profiler's table to out after every frames calls of update;
+    // a null out stops it.
+    void setProfileDump(std::ostream* out, std::uint64_t frames);
+
+    // In deterministic mode systems and parallelEach chunks run one after
+    // another in a fixed order on the calling thread, so runs are reproducible
+    // even if callbacks share state.
+    void setDeterministic(bool deterministic);
+    bool isDeterministic() const;
+
+    // Calls fn(Entity&, T0&, Ts&...) for every matching entity, splitting the
+    // rows into cache-sized chunks that are processed across the thread pool.
+    // fn must be safe to call concurrently for different entities.
+    template <typename T0, typename... Ts, typename F>
+    void parallelEach(F&& fn)
+    {
+        using ViewType = View<T0, Ts...>;
+        ViewType view = this->view<T0, Ts...>();
+
+        std::size_t const sizes[] = { sizeof(Entity), sizeof(typename ViewTerm<T0>::Component),
+            sizeof(typename ViewTerm<Ts>::Component)... };
+        std::size_t rowBytes = std::accumulate(std::begin(sizes), std::end(sizes), std::size_t(0));
+        std::size_t chunkRows = std::max<std::size_t>(ChunkBytes / rowBytes, 1);
+
+        std::vector<std::function<void()>> tasks;
+        for (Archetype* archetype : view.archetypes()) {
+            for (std::size_t begin = 0; begin < archetype->size(); begin += chunkRows) {
+                std::size_t end = std::min(begin + chunkRows, archetype->size());
+                tasks.push_back([archetype, begin, end, &fn] { ViewType::each(*archetype, begin, end, fn); });
+            }
+        }
+
+        if (m_deterministic) {
+            for (auto const& task : tasks) {
+                task();
+            }
+        } else {
+            m_pool->run(std::move(tasks));
+        }
+    }
+
+    // The query for entities having all of T0, Ts except the Optional ones.
+    // It is created on first use and stays valid, and up to date, for the
+    // lifetime of the engine.
+    template <typename T0, typename... Ts>
+    Query& query()
+    {
+        using Key = std::tuple<std::remove_const_t<T0>, std::remove_const_t<Ts>...>;
+        std::size_t key = TypeFamily::id<Key>();
+        if (Query* found = findQuery(key)) {
+            return *found;
+        }
+        return addQuery(key, requiredSignature<T0, Ts...>());
+    }
+
     template <typename T0, typename... Ts>
-    Range iterate() { return Range(this, { typeid(T0), typeid(Ts)... }); }
+    Range iterate() { return Range(query<T0, Ts...>()); }
+
+    template <typename T0, typename... Ts>
+    View<T0, Ts...> view() { return View<T0, Ts...>(query<T0, Ts...>()); }
+
+    // Random numbers for the entity at the current tick, for the given
+    // purpose. The same arguments give the same numbers whichever thread asks
+    // and in whatever order, so fixed-step systems can draw from worker
+    // threads and still replay exactly. Within one tick every call with the
+    // same arguments starts the same stream over.
+    RandomStream random(EntityId id, std::uint16_t purpose) const;
+
+    // seeds every stream; chosen at random when the engine is created
+    void setSeed(std::uint64_t seed);
+    std::uint64_t seed() const;
 
-    std::mt19937& rand();
+    // Change version to remember, so as to later ask for only what changed
+    // since with view<...>().changedSince(version). Writes made from now on
+    // are stamped later than it, except those of systems in the caller's own
+    // stage. Outside update call it from one thread at a time.
+    std::uint64_t version();
 };
 }
 
@@ -1,51 +1,167 @@
 #include "entity.h"
+#include "archetype.h"
 #include "ecsengine.h"
 #include "entitysystem.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace ou {
 
-void Entity::added(ECSEngine* engine, Entity::ListIter iter)
+void* Entity::componentData(ComponentId id, bool modify) const
+{
+    EntityRecord const& record = m_engine->m_records[m_id.index];
+    ColumnBase& column = record.archetype->column(id);
+    if (modify) {
+        column.touch(record.row);
+    }
+    return column.at(record.row);
+}
+
+Component const& Entity::component(ComponentId id) const
+{
+    for (auto const& comp : m_components) {
+        if (comp.id() == id) {
+            return comp;
+        }
+    }
+    throw std::runtime_error("Component does not exist");
+}
+
+EntityId Entity::id() const
 {
-    m_engine = engine;
-    m_iter = iter;
+    return m_id;
 }
 
 void Entity::addComponent(Component&& component)
 {
     if (m_engine) {
-        m_engine->m_mappings[component.type()].insert(m_iter);
+        m_engine->addComponent(m_id, std::move(component));
+        return;
     }
 
-    m_components.insert({ component.type(), std::move(component) });
+    if (!has(component.id())) {
+        m_components.push_back(std::move(component));
+    }
 }
 
-void Entity::removeComponent(std::type_index type)
+void Entity::removeComponent(ComponentId id)
 {
-    if (m_components.count(type) == 0) {
+    if (!has(id)) {
         throw std::runtime_error("Component does not exist");
     }
 
     if (m_engine) {
-        m_engine->m_mappings[type].erase(m_iter);
+        m_engine->removeComponent(m_id, id);
+        return;
+    }
+
+    m_components.erase(std::find_if(m_components.begin(), m_components.end(),
+        [&](Component const& comp) { return comp.id() == id; }));
+}
+
+bool Entity::has(ComponentId id) const
+{
+    if (m_engine) {
+        return m_engine->m_records[m_id.index].archetype->has(id);
+    }
+    return std::any_of(m_components.begin(), m_components.end(),
+        [&](Component const& comp) { return comp.id() == id; });
+}
+
+Component::Component(Component const& other)
+    : m_ops(other.m_ops)
+{
+    if (m_ops->isInline) {
+        std::memcpy(m_buffer, other.m_buffer, m_ops->size);
+    } else {
+        m_ptr = m_ops->clone(other.m_ptr);
+    }
+}
+
+Component& Component::operator=(Component const& other)
+{
+    if (this != &other) {
+        Component copy(other);
+        reset();
+        steal(copy);
     }
+    return *this;
+}
 
-    m_components.erase(type);
+Component::Component(Component&& other) noexcept
+{
+    steal(other);
 }
 
-bool Entity::has(std::type_index idx) const
+Component& Component::operator=(Component&& other) noexcept
 {
-    return m_components.count(idx);
+    if (this != &other) {
+        reset();
+        steal(other);
+    }
+    return *this;
+}
+
+Component::~Component()
+{
+    reset();
+}
+
+void Component::steal(Component& other) noexcept
+{
+    m_ops = other.m_ops;
+    if (!m_ops) {
+        return;
+    }
+    if (m_ops->isInline) {
+        std::memcpy(m_buffer, other.m_buffer, m_ops->size);
+    } else {
+        m_ptr = other.m_ptr;
+    }
+    other.m_ops = nullptr;
+}
+
+void Component::reset() noexcept
+{
+    if (m_ops && !m_ops->isInline) {
+        m_ops->destroy(m_ptr);
+    }
+    m_ops = nullptr;
 }
 
 std::type_index Component::type() const
 {
-    return m_self->type();
+    return m_ops->type;
 }
 
-const std::unordered_map<std::type_index, Component>& Entity::components() const
+bool Component::isTag() const
 {
-    return m_components;
+    return m_ops->isTag;
 }
 
-Component::Interface::~Interface() = default;
+ComponentId Component::id() const
+{
+    return m_ops->id;
+}
+
+std::unique_ptr<ColumnBase> Component::makeColumn() const
+{
+    return m_ops->makeColumn();
+}
+
+void Component::moveInto(ColumnBase& column)
+{
+    m_ops->moveInto(data(), column);
+}
+
+void Component::copyInto(ColumnBase& column, std::size_t count) const
+{
+    column.pushCopies(data(), count);
+}
+
+std::vector<Component> const& Entity::components() const
+{
+    return m_components;
+}
 }
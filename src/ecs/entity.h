@@ -1,128 +1,293 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
-#include <list>
+#include "column.h"
+#include "componentpool.h"
+#include "signature.h"
+#include "tags.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 #include <typeindex>
 #include <typeinfo>
-#include <unordered_map>
 #include <vector>
 
 namespace ou {
 
 class EntitySystem;
 class ECSEngine;
+class Archetype;
+
+// Generational handle to an entity owned by an ECSEngine. A handle goes
+// stale once its entity is removed, even if the slot is reused later.
+struct EntityId {
+    std::uint32_t index = UINT32_MAX;
+    std::uint32_t generation = 0;
+
+    std::uint64_t value() const { return (std::uint64_t(generation) << 32) | index; }
+
+    bool operator==(EntityId other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(EntityId other) const { return !(*this == other); }
+};
+
+// Handle to a prefab registered with an ECSEngine
+struct PrefabId {
+    std::uint32_t index = UINT32_MAX;
+};
+
+// Type-erased component value. Small trivially copyable values are stored
+// inline, anything else lives in a block from the pool of its type, so
+// creating and moving components does not hit the heap in steady state.
 class Component {
+public:
+    static constexpr std::size_t InlineSize = 128;
+
 private:
-    struct Interface {
-        virtual ~Interface();
-        virtual std::type_index type() const = 0;
-        virtual Component clone() const = 0;
+    template <typename T>
+    using IsInline = std::integral_constant<bool, sizeof(T) <= InlineSize
+            && alignof(T) <= alignof(std::max_align_t) && std::is_trivially_copyable<T>::value>;
+
+    struct Ops {
+        std::type_info const& type;
+        std::size_t size;
+        bool isInline;
+        bool isTag;
+        ComponentId id;
+        void* (*clone)(void const* data);
+        void (*destroy)(void* data);
+        std::unique_ptr<ColumnBase> (*makeColumn)();
+        void (*moveInto)(void* data, ColumnBase& column);
     };
 
     template <typename T>
-    struct Model final : Interface {
-
-        Model(T x)
-            : data(std::move(x))
-        {
+    static void* cloneValue(void const* data)
+    {
+        void* block = ComponentPool<T>::allocate();
+        try {
+            return new (block) T(*static_cast<T const*>(data));
+        } catch (...) {
+            ComponentPool<T>::release(block);
+            throw;
         }
+    }
+
+    template <typename T>
+    static void destroyValue(void* data)
+    {
+        static_cast<T*>(data)->~T();
+        ComponentPool<T>::release(data);
+    }
 
-        Component clone() const { return data; }
+    template <typename T>
+    static std::unique_ptr<ColumnBase> makeColumnFor() { return std::make_unique<Column<T>>(); }
 
-        std::type_index type() const { return typeid(T); }
+    template <typename T>
+    static void moveValueInto(void* data, ColumnBase& column)
+    {
+        static_cast<Column<T>&>(column).push(std::move(*static_cast<T*>(data)));
+    }
 
-        T data;
-    };
+    template <typename T>
+    static Ops const& opsFor()
+    {
+        static Ops const ops{ typeid(T), sizeof(T), IsInline<T>::value, IsTag<T>::value, ComponentIds::id<T>(),
+            &cloneValue<T>, &destroyValue<T>, &makeColumnFor<T>, &moveValueInto<T> };
+        return ops;
+    }
 
-    std::unique_ptr<Interface> m_self;
+    Ops const* m_ops = nullptr;
+    union {
+        alignas(std::max_align_t) unsigned char m_buffer[InlineSize];
+        void* m_ptr;
+    };
 
-public:
     template <typename T>
-    Component(T x)
-        : m_self(std::make_unique<Model<T>>(std::move(x)))
+    void construct(T&& x, std::true_type)
     {
+        new (m_buffer) T(std::move(x));
     }
 
-    Component(Component const& other)
-        : m_self(other.m_self->clone().m_self)
+    template <typename T>
+    void construct(T&& x, std::false_type)
     {
+        void* block = ComponentPool<T>::allocate();
+        try {
+            m_ptr = new (block) T(std::move(x));
+        } catch (...) {
+            ComponentPool<T>::release(block);
+            throw;
+        }
     }
 
-    Component& operator=(Component const& other)
+    void* data() { return m_ops->isInline ? static_cast<void*>(m_buffer) : m_ptr; }
+
+    void const* data() const { return m_ops->isInline ? static_cast<void const*>(m_buffer) : m_ptr; }
+
+    void steal(Component& other) noexcept;
+
+    void reset() noexcept;
+
+public:
+    template <typename T>
+    Component(T x)
+        : m_ops(&opsFor<T>())
     {
-        m_self = other.m_self->clone().m_self;
-        return *this;
+        construct<T>(std::move(x), IsInline<T>{});
     }
 
-    Component(Component&&) noexcept = default;
-    Component& operator=(Component&&) noexcept = default;
+    Component(Component const& other);
+    Component& operator=(Component const& other);
+
+    Component(Component&& other) noexcept;
+    Component& operator=(Component&& other) noexcept;
+
+    ~Component();
 
     template <typename T>
     T const& get() const
     {
-        if (m_self->type() != typeid(T)) {
+        if (!is<T>()) {
             throw std::runtime_error("Types not equal");
         }
-        return static_cast<Model<T> const*>(m_self.get())->data;
+        return *static_cast<T const*>(data());
     }
 
     template <typename T>
     T& get()
     {
-        if (m_self->type() != typeid(T)) {
+        if (!is<T>()) {
             throw std::runtime_error("Types not equal");
         }
-        return static_cast<Model<T>*>(m_self.get())->data;
+        return *static_cast<T*>(data());
     }
 
     template <typename T>
     bool is() const
     {
-        Interface const& self = *m_self;
-        return typeid(Model<T>) == typeid(self);
+        return m_ops->id == ComponentIds::id<T>();
     }
 
     std::type_index type() const;
+
+    ComponentId id() const;
+
+    // tags are kept in the signature of their archetype rather than in a column
+    bool isTag() const;
+
+    std::unique_ptr<ColumnBase> makeColumn() const;
+
+    // moves the value to the end of a column of the same type
+    void moveInto(ColumnBase& column);
+
+    // appends count copies of the value to a column of the same type
+    void copyInto(ColumnBase& column, std::size_t count) const;
+};
+
+class Entity;
+
+template <typename... Ts>
+struct IsSingleEntity : std::false_type {
+};
+
+template <>
+struct IsSingleEntity<Entity> : std::true_type {
 };
 
 class Entity {
-    std::unordered_map<std::type_index, Component> m_components;
+    friend class ECSEngine;
+    friend class Archetype;
+    friend class CommandBuffer;
+
+    // only used until the entity is added to an engine
+    std::vector<Component> m_components;
+
     ECSEngine* m_engine = nullptr;
+    EntityId m_id;
+
+    // marks the component as changed unless only read access is asked for
+    void* componentData(ComponentId id, bool modify) const;
+
+    Component const& component(ComponentId id) const;
+
+    template <typename T>
+    T& attached(std::true_type) const
+    {
+        if (!has<T>()) {
+            throw std::runtime_error("Component does not exist");
+        }
+        return tagInstance<T>();
+    }
 
-    using ListIter = std::list<Entity>::iterator;
-    ListIter m_iter;
+    template <typename T>
+    T& attached(std::false_type) const
+    {
+        return *static_cast<T*>(componentData(ComponentIds::id<T>(), !std::is_const<T>::value));
+    }
 
 public:
     Entity() = default;
 
-    template <typename... Ts>
+    // Not for a single Entity, which would otherwise be taken for a
+    // component instead of being copied or moved.
+    template <typename... Ts,
+        typename = std::enable_if_t<!IsSingleEntity<std::decay_t<Ts>...>::value>>
     Entity(Ts&&... comps)
-        : m_components{ { typeid(Ts), Component(std::forward<Ts>(comps)) }... }
     {
+        m_components.reserve(sizeof...(Ts));
+        int expand[] = { 0, (addComponent(Component(std::forward<Ts>(comps))), 0)... };
+        (void)expand;
     }
 
-    void added(ECSEngine* engine, ListIter iter);
+    EntityId id() const;
 
+    // once added to an engine, adding or removing a component moves the entity
+    // to another archetype, which invalidates references to it
     void addComponent(Component&& component);
 
-    void removeComponent(std::type_index type);
+    void removeComponent(ComponentId id);
 
     template <typename T>
-    void removeComponent() { removeComponent(typeid(T)); }
+    void removeComponent() { removeComponent(ComponentIds::id<T>()); }
 
-    bool has(std::type_index idx) const;
+    bool has(ComponentId id) const;
 
     template <typename T>
-    bool has() const { return has(typeid(T)); }
+    bool has() const { return has(ComponentIds::id<T>()); }
 
     template <typename T>
-    T& get() { return m_components.at(typeid(T)).get<T>(); }
+    T& get()
+    {
+        if (!m_engine) {
+            return const_cast<Component&>(component(ComponentIds::id<T>())).template get<T>();
+        }
+        return attached<T>(IsTag<T>{});
+    }
 
     template <typename T>
-    T const& get() const { return m_components.at(typeid(T)).get<T>(); }
+    T const& get() const
+    {
+        if (!m_engine) {
+            return component(ComponentIds::id<T>()).template get<T>();
+        }
+        return attached<T const>(IsTag<T>{});
+    }
 
-    std::unordered_map<std::type_index, Component> const& components() const;
+    std::vector<Component> const& components() const;
+};
+}
+
+namespace std {
+template <>
+struct hash<ou::EntityId> {
+    size_t operator()(ou::EntityId id) const
+    {
+        return hash<uint64_t>{}(id.value());
+    }
 };
 }
 
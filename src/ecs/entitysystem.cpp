@@ -0,0 +1,27 @@
+#include "entitysystem.h"
+
+namespace ou {
+
+bool EntitySystem::isMainThreadOnly() const
+{
+    return m_mainThread;
+}
+
+bool EntitySystem::isFixedStep() const
+{
+    return m_fixedStep;
+}
+
+float EntitySystem::rate() const
+{
+    return m_rate;
+}
+
+bool EntitySystem::conflictsWith(EntitySystem const& other) const
+{
+    if (!m_declared || !other.m_declared) {
+        return true;
+    }
+    return (m_writes & (other.m_writes | other.m_reads)).any() || (m_reads & other.m_writes).any();
+}
+}
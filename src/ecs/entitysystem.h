@@ -1,16 +1,86 @@
 #ifndef ENTITYSYSTEM_H
 #define ENTITYSYSTEM_H
 
+#include "signature.h"
+
+#include <cstdint>
+
 namespace ou {
 
 class ECSEngine;
 
 class EntitySystem {
+    friend class ECSEngine;
+
+    // resources take ComponentIds too, so both fit one bitmask
+    Signature m_reads;
+    Signature m_writes;
+    bool m_declared = false;
+    bool m_mainThread = false;
+    bool m_fixedStep = false;
+    float m_rate = 0;
+
+    // kept by ECSEngine: where in its period the system was placed when it
+    // was added, as a fraction of it, the delta passed to the coming update,
+    // the time accumulated since the last one, or since the system was
+    // added, and when the next one is due
+    float m_offset = 0;
+    float m_deltaTime = 0;
+    float m_elapsed = 0;
+    float m_due = 0;
+    bool m_started = false;
+    // fixed-step systems with a rate run on the ticks t for which
+    // (t + phase) % interval is 0
+    std::uint64_t m_interval = 1;
+    std::uint64_t m_phase = 0;
+    std::uint64_t m_addedTick = 0;
+
+protected:
+    // Systems that declare the components they touch may run concurrently
+    // with systems they do not conflict with. A system that declares nothing
+    // runs alone. Declared systems must make structural changes through
+    // ECSEngine::commands().
+    template <typename... Ts>
+    void reads()
+    {
+        m_reads |= ComponentIds::signature<Ts...>();
+        m_declared = true;
+    }
+
+    template <typename... Ts>
+    void writes()
+    {
+        m_writes |= ComponentIds::signature<Ts...>();
+        m_declared = true;
+    }
+
+    // e.g. for systems issuing OpenGL or GLUT calls
+    void runOnMainThread() { m_mainThread = true; }
+
+    // The system is updated at the engine's fixed delta instead of once per
+    // frame. All fixed-step systems are updated together, in the place the
+    // one of highest priority has among the other systems.
+    void runAtFixedStep() { m_fixedStep = true; }
+
+    // The system is updated about hz times a second instead of every frame,
+    // or every tick for fixed-step systems, and is passed the time since its
+    // last update, or since it was added but at most one period for the
+    // first. The engine spreads systems of the same rate over different
+    // frames or ticks. A fixed-step system's rate is rounded to a whole
+    // number of ticks.
+    void runAtRate(float hz) { m_rate = hz; }
+
 public:
     EntitySystem() = default;
     virtual ~EntitySystem() = default;
     virtual void update(ECSEngine& engine, float deltaTime) = 0;
     virtual void afterUpdate(ECSEngine&) {}
+
+    bool isMainThreadOnly() const;
+    bool isFixedStep() const;
+    // updates per second, 0 for every frame or tick
+    float rate() const;
+    bool conflictsWith(EntitySystem const& other) const;
 };
 }
 
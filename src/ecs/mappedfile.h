@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace ou {
+
+// A whole file mapped read-only into memory. Pages are read in by the OS as
+// they are touched, instead of being copied through a stream buffer.
+class MappedFile {
+    void const* m_data = nullptr;
+    std::size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+
+public:
+    // throws if the file cannot be opened or mapped
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    void const* data() const;
+    std::size_t size() const;
+};
+}
+
+#endif // MAPPEDFILE_H
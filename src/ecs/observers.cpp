@@ -0,0 +1,150 @@
+#include "ecsengine.h"
+
+#include <algorithm>
+
+namespace ou {
+
+static bool lessId(EntityId a, EntityId b)
+{
+    return a.index != b.index ? a.index < b.index : a.generation < b.generation;
+}
+
+ECSEngine::Observers& ECSEngine::observers(ComponentId id, bool structural)
+{
+    if (m_observers.size() <= id) {
+        m_observers.resize(id + 1);
+    }
+    if (structural && std::find(m_observedTypes.begin(), m_observedTypes.end(), id) == m_observedTypes.end()) {
+        m_observedTypes.push_back(id);
+    }
+    return m_observers[id];
+}
+
+void ECSEngine::recordEvent(EntityId id, ComponentId component, bool added)
+{
+    if (component < m_observers.size()) {
+        Observers& observed = m_observers[component];
+        if (!observed.added.empty() || !observed.removed.empty()) {
+            observed.events.emplace_back(id, added);
+        }
+    }
+}
+
+void ECSEngine::recordEvents(Archetype& archetype, std::size_t begin, std::size_t end, bool added)
+{
+    for (ComponentId id : m_observedTypes) {
+        if (!archetype.has(id)) {
+            continue;
+        }
+        auto& events = m_observers[id].events;
+        for (std::size_t row = begin; row < end; ++row) {
+            events.emplace_back(archetype.entity(row).id(), added);
+        }
+    }
+}
+
+void ECSEngine::recordAllEvents(bool added)
+{
+    if (m_observedTypes.empty()) {
+        return;
+    }
+    for (auto const& archetype : m_archetypes) {
+        recordEvents(*archetype, 0, archetype->size(), added);
+    }
+}
+
+void ECSEngine::notifyObservers()
+{
+    if (m_notifying) {
+        return;
+    }
+    m_notifying = true;
+
+    std::vector<std::pair<EntityId, bool>> events;
+    std::vector<EntityId> added;
+    std::vector<EntityId> removed;
+    std::vector<EntityId> changed;
+
+    // changes made from here on, by the hooks or outside of update, are
+    // newer than the ones reported now
+    std::uint64_t version = m_version;
+    auto watched = [](Observers const& observed) { return !observed.changed.empty(); };
+    if (std::any_of(m_observers.begin(), m_observers.end(), watched)) {
+        ++m_version;
+    }
+
+    try {
+        for (ComponentId id = 0; id < m_observers.size(); ++id) {
+            Observers& observed = m_observers[id];
+            if (observed.events.empty() && observed.changed.empty()) {
+                continue;
+            }
+
+            // Only the first event of an entity and whether it has the type
+            // now matter: a first add means it did not have it before.
+            events.clear();
+            events.swap(observed.events);
+            std::stable_sort(events.begin(), events.end(),
+                [](std::pair<EntityId, bool> const& a, std::pair<EntityId, bool> const& b) { return lessId(a.first, b.first); });
+            added.clear();
+            removed.clear();
+            for (std::size_t i = 0; i < events.size();) {
+                EntityId entity = events[i].first;
+                bool before = !events[i].second;
+                bool now = alive(entity) && m_records[entity.index].archetype->has(id);
+                if (before) {
+                    removed.push_back(entity);
+                }
+                if (now) {
+                    added.push_back(entity);
+                }
+                while (i < events.size() && events[i].first == entity) {
+                    ++i;
+                }
+            }
+
+            changed.clear();
+            if (!observed.changed.empty()) {
+                for (auto const& archetype : m_archetypes) {
+                    if (!archetype->has(id)) {
+                        continue;
+                    }
+                    ColumnBase const& column = archetype->column(id);
+                    if (column.version() <= observed.reported) {
+                        continue;
+                    }
+                    std::uint64_t const* versions = column.versions();
+                    for (std::size_t row = 0; row < archetype->size(); ++row) {
+                        EntityId entity = archetype->entity(row).id();
+                        if (versions[row] > observed.reported
+                            && !std::binary_search(added.begin(), added.end(), entity, lessId)) {
+                            changed.push_back(entity);
+                        }
+                    }
+                }
+                std::sort(changed.begin(), changed.end(), lessId);
+                observed.reported = version;
+            }
+
+            // the hooks may add more hooks, so none are held across calls
+            for (std::size_t i = 0; !removed.empty() && i < m_observers[id].removed.size(); ++i) {
+                Observer hook = m_observers[id].removed[i];
+                hook(*this, removed);
+            }
+            for (std::size_t i = 0; !added.empty() && i < m_observers[id].added.size(); ++i) {
+                Observer hook = m_observers[id].added[i];
+                hook(*this, added);
+            }
+            for (std::size_t i = 0; !changed.empty() && i < m_observers[id].changed.size(); ++i) {
+                Observer hook = m_observers[id].changed[i];
+                hook(*this, changed);
+            }
+        }
+    } catch (...) {
+        m_notifying = false;
+        throw;
+    }
+
+    m_notifying = false;
+}
+}
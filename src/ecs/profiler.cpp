@@ -0,0 +1,172 @@
+#include "profiler.h"
+#include "allocationcounter.h"
+#include "entitysystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace ou {
+
+constexpr std::size_t RollingHistogram::Window;
+constexpr std::size_t RollingHistogram::Buckets;
+
+static std::string readableName(std::type_index type)
+{
+    char const* name = type.name();
+#ifdef __GNUG__
+    int status = 0;
+    std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+    if (status == 0) {
+        return demangled.get();
+    }
+#endif
+    for (char const* prefix : { "class ", "struct " }) {
+        if (!std::strncmp(name, prefix, std::strlen(prefix))) {
+            return name + std::strlen(prefix);
+        }
+    }
+    return name;
+}
+
+std::size_t RollingHistogram::bucketOf(double value)
+{
+    if (!(value >= 1)) {
+        return 0;
+    }
+    return std::min(static_cast<std::size_t>(std::log2(value)) + 1, Buckets - 1);
+}
+
+void RollingHistogram::record(double value)
+{
+    if (m_count == Window) {
+        --m_buckets[bucketOf(m_samples[m_next])];
+    } else {
+        ++m_count;
+    }
+    m_samples[m_next] = value;
+    ++m_buckets[bucketOf(value)];
+    m_next = (m_next + 1) % Window;
+}
+
+std::size_t RollingHistogram::count() const
+{
+    return m_count;
+}
+
+double RollingHistogram::mean() const
+{
+    if (!m_count) {
+        return 0;
+    }
+    double sum = 0;
+    for (std::size_t i = 0; i < m_count; ++i) {
+        sum += m_samples[i];
+    }
+    return sum / m_count;
+}
+
+double RollingHistogram::max() const
+{
+    if (!m_count) {
+        return 0;
+    }
+    return *std::max_element(m_samples.begin(), m_samples.begin() + m_count);
+}
+
+double RollingHistogram::percentile(double p) const
+{
+    if (!m_count) {
+        return 0;
+    }
+    std::array<double, Window> sorted = m_samples;
+    std::size_t nth = std::min(static_cast<std::size_t>(p * m_count), m_count - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.begin() + m_count);
+    return sorted[nth];
+}
+
+std::array<std::uint32_t, RollingHistogram::Buckets> const& RollingHistogram::buckets() const
+{
+    return m_buckets;
+}
+
+SystemStats::SystemStats(std::type_index type)
+    : type(type)
+    , name(readableName(type))
+{
+}
+
+Profiler::Scope::Scope(CallStats& stats)
+    : m_stats(stats)
+    , m_start(std::chrono::steady_clock::now())
+    , m_allocations(AllocationCounter::thisThread())
+{
+}
+
+Profiler::Scope::~Scope()
+{
+    using namespace std::chrono;
+    std::uint64_t allocations = AllocationCounter::thisThread() - m_allocations;
+    ++m_stats.calls;
+    m_stats.time.record(duration<double, std::micro>(steady_clock::now() - m_start).count());
+    m_stats.allocations.record(static_cast<double>(allocations));
+}
+
+void Profiler::add(EntitySystem const& system)
+{
+    m_stats.push_back(std::make_unique<SystemStats>(typeid(system)));
+    m_bySystem[&system] = m_stats.back().get();
+}
+
+SystemStats& Profiler::stats(EntitySystem const& system)
+{
+    return *m_bySystem.at(&system);
+}
+
+std::vector<SystemStats const*> Profiler::all() const
+{
+    std::vector<SystemStats const*> result;
+    for (auto const& stats : m_stats) {
+        result.push_back(stats.get());
+    }
+    return result;
+}
+
+SystemStats const* Profiler::find(std::type_index type) const
+{
+    auto it = std::find_if(m_stats.begin(), m_stats.end(),
+        [&](std::unique_ptr<SystemStats> const& stats) { return stats->type == type; });
+    return it != m_stats.end() ? it->get() : nullptr;
+}
+
+void Profiler::dump(std::ostream& out) const
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %-12s %10s %10s %10s %10s %10s %12s %10s\n",
+        "system", "call", "calls", "mean us", "p50 us", "p99 us", "max us", "mean allocs", "max allocs");
+    out << line;
+
+    for (auto const& stats : m_stats) {
+        std::pair<char const*, CallStats const*> const calls[] = {
+            { "update", &stats->update },
+            { "afterUpdate", &stats->afterUpdate },
+        };
+        for (auto const& call : calls) {
+            CallStats const& s = *call.second;
+            std::snprintf(line, sizeof(line), "%-24.24s %-12s %10llu %10.1f %10.1f %10.1f %10.1f %12.1f %10.0f\n",
+                stats->name.c_str(), call.first, static_cast<unsigned long long>(s.calls),
+                s.time.mean(), s.time.percentile(0.5), s.time.percentile(0.99), s.time.max(),
+                s.allocations.mean(), s.allocations.max());
+            out << line;
+        }
+    }
+}
+}
@@ -0,0 +1,112 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ou {
+
+class EntitySystem;
+
+// Keeps the last Window samples together with a histogram of them. Old
+// samples drop out as new ones come in, so memory stays constant and the
+// figures follow recent behaviour.
+class RollingHistogram {
+public:
+    static constexpr std::size_t Window = 256;
+
+    // bucket 0 counts samples below 1, bucket i > 0 those in [2^(i-1), 2^i),
+    // the last bucket also everything above
+    static constexpr std::size_t Buckets = 32;
+
+    void record(double value);
+
+    // number of samples in the window
+    std::size_t count() const;
+
+    double mean() const;
+    double max() const;
+
+    // p in [0, 1], e.g. 0.99 for the 99th percentile
+    double percentile(double p) const;
+
+    std::array<std::uint32_t, Buckets> const& buckets() const;
+
+private:
+    std::array<double, Window> m_samples{};
+    std::array<std::uint32_t, Buckets> m_buckets{};
+    std::size_t m_next = 0;
+    std::size_t m_count = 0;
+
+    static std::size_t bucketOf(double value);
+};
+
+// Figures for one entry point of a system
+struct CallStats {
+    std::uint64_t calls = 0;
+
+    // wall time per call in microseconds
+    RollingHistogram time;
+
+    // heap allocations per call, counting those made on the thread that
+    // runs the system; work it hands to other threads is not included. Only
+    // counted in programs that opt in, see AllocationCounter.
+    RollingHistogram allocations;
+};
+
+struct SystemStats {
+    std::type_index type;
+    std::string name;
+    CallStats update;
+    CallStats afterUpdate;
+
+    explicit SystemStats(std::type_index type);
+};
+
+// Records what ECSEngine::update spends in each system. The stats of a
+// system are only written by the thread running it, so they should be read
+// between updates.
+class Profiler {
+    std::vector<std::unique_ptr<SystemStats>> m_stats;
+    std::unordered_map<EntitySystem const*, SystemStats*> m_bySystem;
+
+public:
+    // measures from construction to destruction
+    class Scope {
+        CallStats& m_stats;
+        std::chrono::steady_clock::time_point m_start;
+        std::uint64_t m_allocations;
+
+    public:
+        explicit Scope(CallStats& stats);
+        ~Scope();
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+    };
+
+    void add(EntitySystem const& system);
+    SystemStats& stats(EntitySystem const& system);
+
+    // in the order the systems were added
+    std::vector<SystemStats const*> all() const;
+
+    // the stats of the first system of type T, nullptr if there is none
+    template <typename T>
+    SystemStats const* find() const { return find(typeid(T)); }
+    SystemStats const* find(std::type_index type) const;
+
+    // writes a table of all systems
+    void dump(std::ostream& out) const;
+};
+}
+
+#endif // PROFILER_H
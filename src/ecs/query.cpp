@@ -0,0 +1,30 @@
+#include "query.h"
+#include "archetype.h"
+
+namespace ou {
+
+Query::Query(Signature const& signature)
+    : m_signature(signature)
+{
+}
+
+Signature const& Query::signature() const
+{
+    return m_signature;
+}
+
+std::vector<Archetype*> const& Query::archetypes() const
+{
+    return m_archetypes;
+}
+
+bool Query::matches(Archetype const& archetype) const
+{
+    return (archetype.signature() & m_signature) == m_signature;
+}
+
+void Query::add(Archetype& archetype)
+{
+    m_archetypes.push_back(&archetype);
+}
+}
@@ -0,0 +1,35 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "signature.h"
+
+#include <vector>
+
+namespace ou {
+
+class Archetype;
+
+// Archetypes holding all of a set of component types. The engine keeps each
+// query it hands out up to date as archetypes are created, so iterating one
+// never has to search for matching entities.
+class Query {
+    Signature m_signature;
+    std::vector<Archetype*> m_archetypes;
+
+public:
+    explicit Query(Signature const& signature);
+
+    Query(Query const&) = delete;
+    Query& operator=(Query const&) = delete;
+
+    Signature const& signature() const;
+
+    std::vector<Archetype*> const& archetypes() const;
+
+    bool matches(Archetype const& archetype) const;
+
+    void add(Archetype& archetype);
+};
+}
+
+#endif // QUERY_H
@@ -0,0 +1,32 @@
+#include "random.h"
+
+namespace ou {
+
+std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key)
+{
+    std::uint32_t const M0 = 0xD2511F53;
+    std::uint32_t const M1 = 0xCD9E8D57;
+    std::uint32_t const W0 = 0x9E3779B9;
+    std::uint32_t const W1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round) {
+        std::uint64_t p0 = std::uint64_t(M0) * counter[0];
+        std::uint64_t p1 = std::uint64_t(M1) * counter[2];
+        counter = { {
+            std::uint32_t(p1 >> 32) ^ counter[1] ^ key[0],
+            std::uint32_t(p1),
+            std::uint32_t(p0 >> 32) ^ counter[3] ^ key[1],
+            std::uint32_t(p0),
+        } };
+        key[0] += W0;
+        key[1] += W1;
+    }
+    return counter;
+}
+
+RandomStream::RandomStream(std::uint64_t seed, std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint16_t d)
+    : m_counter{ { a, b, c, d } }
+    , m_key{ { std::uint32_t(seed), std::uint32_t(seed >> 32) } }
+{
+}
+}
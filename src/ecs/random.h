@@ -0,0 +1,55 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace ou {
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). The numbers are a pure function of the key
+// and the counter, so a stream can be recreated anywhere from its inputs
+// instead of being shared and advanced in some order.
+std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key);
+
+// A stream of random numbers determined by a seed and four words naming it,
+// e.g. entity, tick and purpose. Streams with different names are
+// independent. Also usable as a UniformRandomBitGenerator, but note the
+// standard distributions give different results on different standard
+// libraries, uniform does not.
+class RandomStream {
+    std::array<std::uint32_t, 4> m_counter;
+    std::array<std::uint32_t, 2> m_key;
+    std::array<std::uint32_t, 4> m_block{};
+    std::size_t m_used = 4;
+
+public:
+    using result_type = std::uint32_t;
+
+    // only the low 16 bits of d are used, the rest count blocks drawn
+    RandomStream(std::uint64_t seed, std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint16_t d);
+
+    std::uint32_t next()
+    {
+        if (m_used == m_block.size()) {
+            m_block = philox(m_counter, m_key);
+            m_counter[3] += 1 << 16;
+            m_used = 0;
+        }
+        return m_block[m_used++];
+    }
+
+    // uniformly distributed in [min, max)
+    float uniform(float min, float max)
+    {
+        return min + (max - min) * ((next() >> 8) * (1.0f / (1 << 24)));
+    }
+
+    std::uint32_t operator()() { return next(); }
+    static constexpr std::uint32_t min() { return 0; }
+    static constexpr std::uint32_t max() { return std::numeric_limits<std::uint32_t>::max(); }
+};
+}
+
+#endif // RANDOM_H
@@ -0,0 +1,229 @@
+#include "rollback.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ou {
+
+void Rollback::setCapacity(std::size_t ticks, std::size_t maxBytes)
+{
+    m_capacity = ticks;
+    m_maxBytes = maxBytes;
+    trim();
+}
+
+std::size_t Rollback::capacity() const
+{
+    return m_capacity;
+}
+
+std::size_t Rollback::size() const
+{
+    return m_frames.size();
+}
+
+std::size_t Rollback::bytes() const
+{
+    return m_bytes + m_spareBytes;
+}
+
+std::uint64_t Rollback::oldestTick() const
+{
+    return m_frames.front().tick;
+}
+
+std::uint64_t Rollback::newestTick() const
+{
+    return m_frames.back().tick;
+}
+
+template <typename T>
+static std::size_t bytesOf(std::vector<T> const& values)
+{
+    return values.capacity() * sizeof(T);
+}
+
+void Rollback::capture(std::uint64_t tick, std::uint64_t version,
+    std::vector<std::unique_ptr<Archetype>> const& archetypes, std::vector<EntityRecord> const& records,
+    std::vector<std::uint32_t> const& freeIndices)
+{
+    if (m_capacity == 0) {
+        return;
+    }
+
+    Frame const* last = m_frames.empty() ? nullptr : &m_frames.back();
+    Frame frame;
+    frame.tick = tick;
+    frame.archetypes.reserve(archetypes.size());
+    bool layoutChanged = !last;
+
+    for (std::size_t i = 0; i < archetypes.size(); ++i) {
+        Archetype& archetype = *archetypes[i];
+        ArchetypeState const* before = last && i < last->archetypes.size() ? &last->archetypes[i] : nullptr;
+        bool moved = !before || archetype.layoutVersion() > m_version;
+        layoutChanged = layoutChanged || moved;
+
+        ArchetypeState state;
+        if (moved) {
+            auto ids = std::make_shared<std::vector<EntityId>>();
+            ids->reserve(archetype.size());
+            for (std::size_t row = 0; row < archetype.size(); ++row) {
+                ids->push_back(archetype.entity(row).id());
+            }
+            m_bytes += bytesOf(*ids);
+            state.ids = std::move(ids);
+        } else {
+            state.ids = before->ids;
+        }
+
+        Archetype::Columns const& columns = archetype.columns();
+        state.columns.reserve(columns.size());
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            if (moved || columns[c]->version() > m_version) {
+                state.columns.push_back(copyColumn(i, c, *columns[c]));
+            } else {
+                state.columns.push_back(before->columns[c]);
+            }
+        }
+        frame.archetypes.push_back(std::move(state));
+    }
+
+    if (layoutChanged) {
+        auto layout = std::make_shared<Layout>();
+        layout->records = records.size();
+        layout->free.reserve(freeIndices.size());
+        for (std::uint32_t index : freeIndices) {
+            layout->free.push_back(EntityId{ index, records[index].generation });
+        }
+        m_bytes += bytesOf(layout->free);
+        frame.layout = std::move(layout);
+    } else {
+        frame.layout = last->layout;
+    }
+
+    m_frames.push_back(std::move(frame));
+    m_version = version;
+    trim();
+}
+
+std::shared_ptr<ColumnBase const> Rollback::copyColumn(std::size_t archetype, std::size_t column,
+    ColumnBase const& values)
+{
+    if (archetype < m_spares.size() && column < m_spares[archetype].size() && m_spares[archetype][column]) {
+        std::shared_ptr<ColumnBase> copy = std::move(m_spares[archetype][column]);
+        m_spareBytes -= copy->bytes();
+        values.copyTo(*copy);
+        m_bytes += copy->bytes();
+        return std::shared_ptr<ColumnBase const>(std::move(copy));
+    }
+    std::shared_ptr<ColumnBase const> copy = values.copy();
+    m_bytes += copy->bytes();
+    return copy;
+}
+
+void Rollback::release(Frame const& frame)
+{
+    // only what no other frame shares goes away with it
+    if (frame.layout.use_count() == 1) {
+        m_bytes -= bytesOf(frame.layout->free);
+    }
+    for (std::size_t i = 0; i < frame.archetypes.size(); ++i) {
+        ArchetypeState const& state = frame.archetypes[i];
+        if (state.ids.use_count() == 1) {
+            m_bytes -= bytesOf(*state.ids);
+        }
+        if (m_spares.size() <= i) {
+            m_spares.resize(i + 1);
+        }
+        auto& spares = m_spares[i];
+        spares.resize(state.columns.size());
+        for (std::size_t c = 0; c < state.columns.size(); ++c) {
+            if (state.columns[c].use_count() != 1) {
+                continue;
+            }
+            if (spares[c]) {
+                m_spareBytes -= spares[c]->bytes();
+            }
+            // nothing else refers to the copy, so it may be written again
+            spares[c] = std::const_pointer_cast<ColumnBase>(state.columns[c]);
+            m_bytes -= spares[c]->bytes();
+            m_spareBytes += spares[c]->bytes();
+        }
+    }
+}
+
+void Rollback::dropOldest()
+{
+    release(m_frames.front());
+    m_frames.pop_front();
+}
+
+void Rollback::dropSpares()
+{
+    m_spares.clear();
+    m_spareBytes = 0;
+}
+
+void Rollback::trim()
+{
+    while (m_frames.size() > m_capacity) {
+        dropOldest();
+    }
+    while (m_bytes + m_spareBytes > m_maxBytes) {
+        if (m_spareBytes > 0) {
+            dropSpares();
+        } else if (m_frames.size() > 1) {
+            dropOldest();
+        } else {
+            break;
+        }
+    }
+}
+
+std::size_t Rollback::restore(std::uint64_t tick, ECSEngine& engine,
+    std::vector<std::unique_ptr<Archetype>> const& archetypes, std::vector<EntityRecord>& records,
+    std::vector<std::uint32_t>& freeIndices)
+{
+    auto held = std::find_if(m_frames.begin(), m_frames.end(), [&](Frame const& frame) { return frame.tick == tick; });
+    if (held == m_frames.end()) {
+        throw std::runtime_error("Tick is not held for rollback");
+    }
+
+    // the frames after it belong to a future that is about to be rewritten
+    while (m_frames.back().tick != tick) {
+        release(m_frames.back());
+        m_frames.pop_back();
+    }
+
+    Frame const& frame = m_frames.back();
+    records.assign(frame.layout->records, EntityRecord{});
+    freeIndices.clear();
+    for (EntityId id : frame.layout->free) {
+        records[id.index].generation = id.generation;
+        freeIndices.push_back(id.index);
+    }
+
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < archetypes.size(); ++i) {
+        if (i >= frame.archetypes.size()) {
+            archetypes[i]->clear();
+            continue;
+        }
+        ArchetypeState const& state = frame.archetypes[i];
+        archetypes[i]->assign(engine, *state.ids, state.columns);
+        for (std::size_t row = 0; row < state.ids->size(); ++row) {
+            EntityId id = (*state.ids)[row];
+            records[id.index] = EntityRecord{ archetypes[i].get(), row, id.generation };
+        }
+        count += state.ids->size();
+    }
+    return count;
+}
+
+void Rollback::clear()
+{
+    m_frames.clear();
+    dropSpares();
+    m_bytes = 0;
+}
+}
@@ -0,0 +1,95 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "archetype.h"
+#include "column.h"
+#include "entity.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace ou {
+
+// Copies of the entities as they were after each of the last few ticks.
+// A copy of a column, or of the rows of an archetype, is shared with the
+// tick before for as long as it does not change, so capturing a tick only
+// costs the columns written during it. Columns of archetypes whose rows
+// were added, removed or reordered count as written.
+class Rollback {
+    struct ArchetypeState {
+        std::shared_ptr<std::vector<EntityId> const> ids;
+        std::vector<std::shared_ptr<ColumnBase const>> columns;
+    };
+
+    // The records of live entities follow from the rows of the archetypes,
+    // so only the free slots are kept, with the generation each will be
+    // reused with.
+    struct Layout {
+        std::size_t records;
+        std::vector<EntityId> free;
+    };
+
+    struct Frame {
+        std::uint64_t tick;
+        std::shared_ptr<Layout const> layout;
+        // in order of creation of the archetypes
+        std::vector<ArchetypeState> archetypes;
+    };
+
+    std::deque<Frame> m_frames;
+    std::size_t m_capacity = 0;
+    std::size_t m_maxBytes = 0;
+    // taken by the copies frames hold, and by the spares
+    std::size_t m_bytes = 0;
+    std::size_t m_spareBytes = 0;
+
+    // engine version the last frame was captured at
+    std::uint64_t m_version = 0;
+
+    // Copies no frame holds any more, by archetype and column, to be
+    // overwritten by the next copy of the same column instead of allocating.
+    // They count towards bytes(), but are given up before any frame is.
+    std::vector<std::vector<std::shared_ptr<ColumnBase>>> m_spares;
+
+    std::shared_ptr<ColumnBase const> copyColumn(std::size_t archetype, std::size_t column, ColumnBase const& values);
+    void release(Frame const& frame);
+    void dropOldest();
+    void dropSpares();
+    // drops what does not fit the capacity
+    void trim();
+
+public:
+    // keeps at most ticks frames, and fewer if their copies take more than maxBytes
+    void setCapacity(std::size_t ticks, std::size_t maxBytes);
+
+    std::size_t capacity() const;
+
+    // number of frames held
+    std::size_t size() const;
+
+    // memory taken by the copies
+    std::size_t bytes() const;
+
+    std::uint64_t oldestTick() const;
+    std::uint64_t newestTick() const;
+
+    // Records the entities after the given tick. Everything changed since the
+    // last capture must have been stamped with a later version than the one
+    // passed then.
+    void capture(std::uint64_t tick, std::uint64_t version, std::vector<std::unique_ptr<Archetype>> const& archetypes,
+        std::vector<EntityRecord> const& records, std::vector<std::uint32_t> const& freeIndices);
+
+    // Puts back the entities as they were after the tick, which must be held,
+    // and forgets the frames after it. Archetypes created since are emptied.
+    // Returns the number of entities.
+    std::size_t restore(std::uint64_t tick, ECSEngine& engine, std::vector<std::unique_ptr<Archetype>> const& archetypes,
+        std::vector<EntityRecord>& records, std::vector<std::uint32_t>& freeIndices);
+
+    void clear();
+};
+}
+
+#endif // ROLLBACK_H
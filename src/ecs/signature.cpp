@@ -0,0 +1,17 @@
+#include "signature.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace ou {
+
+ComponentId ComponentIds::next()
+{
+    static std::atomic<ComponentId> counter{ 0 };
+    ComponentId id = counter++;
+    if (id >= MaxComponentTypes) {
+        throw std::runtime_error("Too many component types");
+    }
+    return id;
+}
+}
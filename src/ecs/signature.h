@@ -0,0 +1,47 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <bitset>
+#include <cstddef>
+#include <type_traits>
+
+namespace ou {
+
+using ComponentId = std::size_t;
+
+static constexpr std::size_t MaxComponentTypes = 256;
+
+// The set of component types of an archetype or a query, one bit per
+// ComponentId, so matching one against the other is a few word-wide ANDs.
+using Signature = std::bitset<MaxComponentTypes>;
+
+// Hands out small consecutive ids to component types on first use. The
+// engine indexes flat arrays with them instead of hashing std::type_index.
+// Ids differ between runs.
+class ComponentIds {
+    static ComponentId next();
+
+    template <typename T>
+    static ComponentId assign()
+    {
+        static ComponentId const id = next();
+        return id;
+    }
+
+public:
+    // T and T const share an id
+    template <typename T>
+    static ComponentId id() { return assign<std::remove_const_t<T>>(); }
+
+    template <typename... Ts>
+    static Signature signature()
+    {
+        Signature signature;
+        int expand[] = { 0, (signature.set(id<Ts>()), 0)... };
+        (void)expand;
+        return signature;
+    }
+};
+}
+
+#endif // SIGNATURE_H
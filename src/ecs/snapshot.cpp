@@ -0,0 +1,271 @@
+#include "snapshot.h"
+#include "ecsengine.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+namespace ou {
+
+// Layout of a snapshot, integers in machine byte order:
+//
+//   u32 magic, u32 format
+//   u64 ticks, u64 seed, f32 accumulated time
+//   u32 type count, then per type: u32 name length, name, u64 raw size
+//   u32 record count, then the u32 generation of each record
+//   u32 free index count, then the u32 free indices
+//   u32 archetype count, then per archetype:
+//       u32 type count, the u32 numbers of the types in the list above,
+//       u64 row count, the u32 entity index of each row,
+//       the rows of each type that is not a tag, in the same order
+static constexpr std::uint32_t SnapshotMagic = 0x4E53554F; // "OUSN"
+static constexpr std::uint32_t SnapshotFormat = 1;
+
+static std::vector<ComponentId> idsOf(Signature const& signature)
+{
+    std::vector<ComponentId> ids;
+    for (ComponentId id = 0; id < MaxComponentTypes; ++id) {
+        if (signature.test(id)) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+void ECSEngine::saveSnapshot(std::string const& path)
+{
+    flushCommands();
+
+    // the types in use, numbered in order of appearance
+    std::vector<ComponentInfo const*> types;
+    std::vector<std::uint32_t> numbers(MaxComponentTypes, UINT32_MAX);
+    std::vector<Archetype*> archetypes;
+    for (auto const& archetype : m_archetypes) {
+        if (archetype->size() == 0) {
+            continue;
+        }
+        archetypes.push_back(archetype.get());
+        for (ComponentId id : idsOf(archetype->signature())) {
+            if (numbers[id] != UINT32_MAX) {
+                continue;
+            }
+            ComponentInfo const* info = m_registry.find(id);
+            if (!info) {
+                throw std::runtime_error("Component type is not registered");
+            }
+            numbers[id] = static_cast<std::uint32_t>(types.size());
+            types.push_back(info);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    SnapshotWriter out(file);
+    out.value(SnapshotMagic);
+    out.value(SnapshotFormat);
+    out.value(m_ticks);
+    out.value(m_seed);
+    out.value(m_accumulator);
+
+    out.value(static_cast<std::uint32_t>(types.size()));
+    for (ComponentInfo const* info : types) {
+        out.value(static_cast<std::uint32_t>(info->name.size()));
+        out.write(info->name.data(), info->name.size());
+        out.value(static_cast<std::uint64_t>(info->rawSize));
+    }
+
+    std::vector<std::uint32_t> generations(m_records.size());
+    for (std::size_t i = 0; i < m_records.size(); ++i) {
+        generations[i] = m_records[i].generation;
+    }
+    out.value(static_cast<std::uint32_t>(generations.size()));
+    out.write(generations.data(), generations.size() * sizeof(std::uint32_t));
+    out.value(static_cast<std::uint32_t>(m_freeIndices.size()));
+    out.write(m_freeIndices.data(), m_freeIndices.size() * sizeof(std::uint32_t));
+
+    out.value(static_cast<std::uint32_t>(archetypes.size()));
+    std::vector<std::uint32_t> indices;
+    for (Archetype* archetype : archetypes) {
+        std::vector<ComponentId> ids = idsOf(archetype->signature());
+        out.value(static_cast<std::uint32_t>(ids.size()));
+        for (ComponentId id : ids) {
+            out.value(numbers[id]);
+        }
+
+        indices.resize(archetype->size());
+        for (std::size_t row = 0; row < indices.size(); ++row) {
+            indices[row] = archetype->entity(row).id().index;
+        }
+        out.value(static_cast<std::uint64_t>(indices.size()));
+        out.write(indices.data(), indices.size() * sizeof(std::uint32_t));
+
+        for (ComponentId id : ids) {
+            ComponentInfo const* info = types[numbers[id]];
+            if (!info->isTag) {
+                info->write(archetype->column(id), out);
+            }
+        }
+    }
+
+    if (!file.flush()) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+void ECSEngine::clearEntities()
+{
+    for (auto const& archetype : m_archetypes) {
+        archetype->clear();
+    }
+    m_records.clear();
+    m_freeIndices.clear();
+    m_entityCount = 0;
+}
+
+void ECSEngine::loadSnapshot(std::string const& path)
+{
+    MappedFile file(path);
+    SnapshotReader in(file.data(), file.size());
+    if (in.value<std::uint32_t>() != SnapshotMagic || in.value<std::uint32_t>() != SnapshotFormat) {
+        throw std::runtime_error("Not a snapshot: " + path);
+    }
+    std::uint64_t ticks = in.value<std::uint64_t>();
+    std::uint64_t seed = in.value<std::uint64_t>();
+    float accumulator = in.value<float>();
+
+    std::vector<ComponentInfo const*> types(in.count<std::uint32_t>(sizeof(std::uint32_t) + sizeof(std::uint64_t)));
+    for (ComponentInfo const*& info : types) {
+        std::uint32_t length = in.value<std::uint32_t>();
+        std::string name(static_cast<char const*>(in.read(length)), length);
+        info = m_registry.find(name);
+        if (!info) {
+            throw std::runtime_error("Component type is not registered: " + name);
+        }
+        if (in.value<std::uint64_t>() != info->rawSize) {
+            throw std::runtime_error("Component type has changed: " + name);
+        }
+    }
+
+    // Everything is read and checked before the entities are replaced, so a
+    // snapshot that fails to load leaves the world as it was.
+    std::vector<EntityRecord> records(in.count<std::uint32_t>(sizeof(std::uint32_t)));
+    for (EntityRecord& record : records) {
+        record.generation = in.value<std::uint32_t>();
+    }
+    // whether each record is taken by a row or by the free list
+    std::vector<bool> taken(records.size());
+    std::vector<std::uint32_t> freeIndices(in.count<std::uint32_t>(sizeof(std::uint32_t)));
+    for (std::uint32_t& index : freeIndices) {
+        index = in.value<std::uint32_t>();
+        if (index >= records.size() || taken[index]) {
+            throw std::runtime_error("Corrupt snapshot");
+        }
+        taken[index] = true;
+    }
+
+    struct Loaded {
+        Signature signature;
+        std::vector<ComponentInfo const*> infos;
+        std::vector<EntityId> ids;
+        std::vector<std::unique_ptr<ColumnBase>> columns; // in the order of infos, without tags
+    };
+    std::vector<Loaded> loaded(in.count<std::uint32_t>(sizeof(std::uint32_t) + sizeof(std::uint64_t)));
+    for (std::size_t i = 0; i < loaded.size(); ++i) {
+        Loaded& archetype = loaded[i];
+        archetype.infos.resize(in.count<std::uint32_t>(sizeof(std::uint32_t)));
+        for (ComponentInfo const*& info : archetype.infos) {
+            std::uint32_t number = in.value<std::uint32_t>();
+            if (number >= types.size() || archetype.signature.test(types[number]->id)) {
+                throw std::runtime_error("Corrupt snapshot");
+            }
+            info = types[number];
+            archetype.signature.set(info->id);
+        }
+        for (std::size_t j = 0; j < i; ++j) {
+            if (loaded[j].signature == archetype.signature) {
+                throw std::runtime_error("Corrupt snapshot");
+            }
+        }
+
+        std::size_t rows = in.count<std::uint64_t>(sizeof(std::uint32_t));
+        auto indices = static_cast<unsigned char const*>(in.read(rows, sizeof(std::uint32_t)));
+        archetype.ids.resize(rows);
+        for (std::size_t row = 0; row < rows; ++row) {
+            EntityId& id = archetype.ids[row];
+            std::memcpy(&id.index, indices + row * sizeof(std::uint32_t), sizeof(std::uint32_t));
+            if (id.index >= records.size() || taken[id.index]) {
+                throw std::runtime_error("Corrupt snapshot");
+            }
+            taken[id.index] = true;
+            id.generation = records[id.index].generation;
+        }
+
+        for (ComponentInfo const* info : archetype.infos) {
+            if (!info->isTag) {
+                std::unique_ptr<ColumnBase> column = info->makeColumn();
+                info->read(*column, rows, in);
+                archetype.columns.push_back(std::move(column));
+            }
+        }
+    }
+    // every record is either free or taken by a row
+    if (std::find(taken.begin(), taken.end(), false) != taken.end()) {
+        throw std::runtime_error("Corrupt snapshot");
+    }
+
+    dropCommands();
+    recordAllEvents(false);
+    clearEntities();
+
+    // the loaded rows count as changed
+    ++m_version;
+    m_records = std::move(records);
+    m_freeIndices = std::move(freeIndices);
+    std::vector<ColumnBase*> columns;
+    for (Loaded const& state : loaded) {
+        Archetype* archetype = findArchetype(state.signature);
+        if (!archetype) {
+            Archetype::Columns empty;
+            std::vector<ComponentId> tags;
+            for (ComponentInfo const* info : state.infos) {
+                if (info->isTag) {
+                    tags.push_back(info->id);
+                } else {
+                    empty.push_back(info->makeColumn());
+                }
+            }
+            archetype = &createArchetype(std::move(empty), std::move(tags));
+        }
+
+        // the archetype may keep its columns in another order
+        columns.clear();
+        for (auto const& column : archetype->columns()) {
+            auto same = [&](std::unique_ptr<ColumnBase> const& loaded) {
+                return loaded->componentId() == column->componentId();
+            };
+            columns.push_back(std::find_if(state.columns.begin(), state.columns.end(), same)->get());
+        }
+        archetype->take(*this, state.ids, columns);
+        for (std::size_t row = 0; row < state.ids.size(); ++row) {
+            EntityId id = state.ids[row];
+            m_records[id.index] = EntityRecord{ archetype, row, id.generation };
+        }
+        m_entityCount += state.ids.size();
+    }
+    recordAllEvents(true);
+
+    m_ticks = ticks;
+    m_seed = seed;
+    m_accumulator = accumulator;
+
+    // the kept ticks lead up to the replaced entities
+    m_rollback.clear();
+    m_rewoundFrom = 0;
+    if (m_rollback.capacity() > 0) {
+        capture();
+    }
+}
+}
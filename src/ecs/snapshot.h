@@ -0,0 +1,94 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ou {
+
+// Appends the bytes of a snapshot to a stream. Values are written in the
+// byte order of the machine, so snapshots only load on the same platform.
+class SnapshotWriter {
+    std::ostream& m_out;
+
+public:
+    explicit SnapshotWriter(std::ostream& out)
+        : m_out(out)
+    {
+    }
+
+    void write(void const* data, std::size_t size)
+    {
+        m_out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+    }
+
+    template <typename T>
+    void value(T const& x)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as bytes");
+        write(&x, sizeof(T));
+    }
+};
+
+// Reads back what a SnapshotWriter wrote, from memory, usually a mapped file.
+// Throws rather than read past the end.
+class SnapshotReader {
+    unsigned char const* m_pos;
+    unsigned char const* m_end;
+
+public:
+    SnapshotReader(void const* data, std::size_t size)
+        : m_pos(static_cast<unsigned char const*>(data))
+        , m_end(m_pos + size)
+    {
+    }
+
+    // the next size bytes, which stay valid as long as the memory read from
+    void const* read(std::size_t size)
+    {
+        if (size > static_cast<std::size_t>(m_end - m_pos)) {
+            throw std::runtime_error("Truncated snapshot");
+        }
+        void const* data = m_pos;
+        m_pos += size;
+        return data;
+    }
+
+    // count items of size bytes each, checked before multiplying so a
+    // corrupt count cannot wrap around
+    void const* read(std::size_t count, std::size_t size)
+    {
+        if (size > 0 && count > static_cast<std::size_t>(m_end - m_pos) / size) {
+            throw std::runtime_error("Truncated snapshot");
+        }
+        return read(count * size);
+    }
+
+    template <typename T>
+    T value()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as bytes");
+        T x;
+        std::memcpy(&x, read(sizeof(T)), sizeof(T));
+        return x;
+    }
+
+    // a count of type T of items that take at least size bytes each, so a
+    // corrupt count is caught before anything is allocated for it
+    template <typename T>
+    std::size_t count(std::size_t size)
+    {
+        T n = value<T>();
+        if (n > static_cast<std::size_t>(m_end - m_pos) / size) {
+            throw std::runtime_error("Truncated snapshot");
+        }
+        return static_cast<std::size_t>(n);
+    }
+};
+}
+
+#endif // SNAPSHOT_H
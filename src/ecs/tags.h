@@ -0,0 +1,22 @@
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <type_traits>
+
+namespace ou {
+
+// Component types without data, such as markers, are tags. Entities do not
+// store them; having one only shows in the signature of the archetype.
+template <typename T>
+using IsTag = std::is_empty<std::remove_const_t<T>>;
+
+// Tags have no state, so every entity can share one instance per type.
+template <typename T>
+T& tagInstance()
+{
+    static std::remove_const_t<T> tag;
+    return tag;
+}
+}
+
+#endif // TAGS_H
@@ -0,0 +1,103 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace ou {
+
+void ThreadPool::Batch::work()
+{
+    std::size_t count = m_tasks.size();
+    for (std::size_t i = m_next++; i < count; i = m_next++) {
+        try {
+            m_tasks[i]();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (++m_finished == count) {
+            m_done.notify_all();
+        }
+    }
+}
+
+ThreadPool::ThreadPool(std::size_t workers)
+{
+    for (std::size_t i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        job();
+    }
+}
+
+std::size_t ThreadPool::workerCount() const
+{
+    return m_workers.size();
+}
+
+std::shared_ptr<ThreadPool::Batch> ThreadPool::start(std::vector<std::function<void()>>&& tasks)
+{
+    auto batch = std::make_shared<Batch>();
+    batch->m_tasks = std::move(tasks);
+
+    // the waiting thread takes part as well, so one helper fewer is needed
+    std::size_t count = batch->m_tasks.size();
+    std::size_t helpers = count > 0 ? std::min(m_workers.size(), count - 1) : 0;
+    if (helpers > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::size_t i = 0; i < helpers; ++i) {
+                m_queue.emplace_back([batch] { batch->work(); });
+            }
+        }
+        m_wake.notify_all();
+    }
+    return batch;
+}
+
+void ThreadPool::wait(Batch& batch)
+{
+    batch.work();
+
+    std::unique_lock<std::mutex> lock(batch.m_mutex);
+    batch.m_done.wait(lock, [&] { return batch.m_finished == batch.m_tasks.size(); });
+    if (batch.m_error) {
+        std::rethrow_exception(batch.m_error);
+    }
+}
+
+void ThreadPool::run(std::vector<std::function<void()>>&& tasks)
+{
+    wait(*start(std::move(tasks)));
+}
+}
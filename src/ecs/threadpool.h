@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ou {
+
+class ThreadPool {
+public:
+    // A set of tasks that the workers and the waiting thread pick from
+    class Batch {
+        friend class ThreadPool;
+
+        std::vector<std::function<void()>> m_tasks;
+        std::atomic<std::size_t> m_next{ 0 };
+        std::size_t m_finished = 0;
+        std::exception_ptr m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+
+        void work();
+    };
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    void workerLoop();
+
+public:
+    explicit ThreadPool(std::size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    std::size_t workerCount() const;
+
+    std::shared_ptr<Batch> start(std::vector<std::function<void()>>&& tasks);
+
+    // the calling thread helps until every task of the batch has finished,
+    // then rethrows the first exception a task threw
+    void wait(Batch& batch);
+
+    void run(std::vector<std::function<void()>>&& tasks);
+};
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,12 @@
+#include "typefamily.h"
+
+#include <atomic>
+
+namespace ou {
+
+std::size_t TypeFamily::next()
+{
+    static std::atomic<std::size_t> counter{ 0 };
+    return counter++;
+}
+}
@@ -0,0 +1,23 @@
+#ifndef TYPEFAMILY_H
+#define TYPEFAMILY_H
+
+#include <cstddef>
+
+namespace ou {
+
+// Hands out small consecutive ids per type, usable as indices into flat
+// arrays. Ids are assigned on first use and differ between runs.
+class TypeFamily {
+    static std::size_t next();
+
+public:
+    template <typename T>
+    static std::size_t id()
+    {
+        static std::size_t const id = next();
+        return id;
+    }
+};
+}
+
+#endif // TYPEFAMILY_H
@@ -0,0 +1,366 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include "archetype.h"
+#include "entity.h"
+#include "query.h"
+#include "tags.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace ou {
+
+// A view term for entities that may or may not have a T; the callback gets a
+// T*, which is null for those without.
+template <typename T>
+struct Optional {
+};
+
+template <typename T>
+struct ViewTerm {
+    using Component = std::remove_const_t<T>;
+    using Reference = T&;
+    static constexpr bool required = true;
+    static constexpr bool mutates = !std::is_const<T>::value;
+};
+
+template <typename T>
+struct ViewTerm<Optional<T>> {
+    using Component = std::remove_const_t<T>;
+    using Reference = T*;
+    static constexpr bool required = false;
+    static constexpr bool mutates = !std::is_const<T>::value;
+};
+
+// the signature of the component types an entity must have to match Ts
+template <typename... Ts>
+Signature requiredSignature()
+{
+    Signature signature;
+    int expand[] = { 0, (ViewTerm<Ts>::required ? (signature.set(ComponentIds::id<typename ViewTerm<Ts>::Component>()), 0) : 0)... };
+    (void)expand;
+    return signature;
+}
+
+// Iterates every entity that has all of Ts, yielding (Entity&, Ts&...).
+// Component columns are looked up once per archetype, so no per-entity
+// hashing or type checks happen. Declare a type const for read-only access.
+// Entities must not be added or removed while a view is being walked.
+// Rows of non-const types are marked as changed when they are visited.
+// Tags among Ts have no values; they yield a shared instance. Optional<T>
+// terms yield a T* instead.
+template <typename... Ts>
+class View {
+    std::vector<Archetype*> const* m_archetypes;
+    std::uint64_t m_since = 0;
+    Signature m_with;
+    Signature m_without;
+
+    template <typename T>
+    struct RowKind : std::integral_constant<int, IsTag<T>::value ? 1 : 0> {
+    };
+
+    template <typename T>
+    struct RowKind<Optional<T>> : std::integral_constant<int, 2> {
+    };
+
+    // row access to the values of a term in one archetype
+    template <typename T, int = RowKind<T>::value>
+    struct Rows {
+        T* data = nullptr;
+
+        Rows() = default;
+        explicit Rows(Archetype& archetype)
+            : data(archetype.template data<std::remove_const_t<T>>())
+        {
+        }
+
+        T& operator[](std::size_t row) const { return data[row]; }
+    };
+
+    template <typename T>
+    struct Rows<T, 1> {
+        Rows() = default;
+        explicit Rows(Archetype&) {}
+
+        T& operator[](std::size_t) const { return tagInstance<T>(); }
+    };
+
+    template <typename T>
+    struct Rows<Optional<T>, 2> {
+        T* data = nullptr;
+        std::size_t stride = 1; // tags all share one instance
+
+        Rows() = default;
+        explicit Rows(Archetype& archetype)
+        {
+            using Component = std::remove_const_t<T>;
+            if (!archetype.signature().test(ComponentIds::id<Component>())) {
+                return;
+            }
+            if (IsTag<T>::value) {
+                data = &tagInstance<T>();
+                stride = 0;
+            } else {
+                data = archetype.template data<Component>();
+            }
+        }
+
+        T* operator[](std::size_t row) const { return data ? data + row * stride : nullptr; }
+    };
+
+    template <typename F>
+    static void eachRow(F& fn, std::size_t begin, std::size_t end, Entity* entities, Rows<Ts>... columns)
+    {
+        for (std::size_t row = begin; row < end; ++row) {
+            fn(entities[row], columns[row]...);
+        }
+    }
+
+    // null for tags and for optional terms the archetype does not have
+    template <typename T>
+    static ColumnBase* columnOf(Archetype& archetype)
+    {
+        using Component = typename ViewTerm<T>::Component;
+        if (IsTag<Component>::value || !archetype.signature().test(ComponentIds::id<Component>())) {
+            return nullptr;
+        }
+        return &archetype.column(ComponentIds::id<Component>());
+    }
+
+    template <typename T>
+    static void touch(Archetype& archetype, std::size_t begin, std::size_t end)
+    {
+        if (!ViewTerm<T>::mutates) {
+            return;
+        }
+        if (ColumnBase* column = columnOf<T>(archetype)) {
+            column->touch(begin, end);
+        }
+    }
+
+    bool accepts(Archetype const& archetype) const
+    {
+        Signature const& signature = archetype.signature();
+        return (signature & m_with) == m_with && (signature & m_without).none();
+    }
+
+    static void touchAll(Archetype& archetype, std::size_t begin, std::size_t end)
+    {
+        int expand[] = { 0, (touch<Ts>(archetype, begin, end), 0)... };
+        (void)expand;
+    }
+
+    // the columns of an archetype changedSince looks at
+    struct Tracked {
+        std::array<ColumnBase*, sizeof...(Ts)> columns;
+        std::size_t count = 0;
+
+        Tracked() = default;
+        explicit Tracked(Archetype& archetype)
+            : columns{ { columnOf<Ts>(archetype)... } }
+        {
+            count = static_cast<std::size_t>(std::remove(columns.begin(), columns.end(), nullptr) - columns.begin());
+        }
+
+        bool changed(std::uint64_t since) const
+        {
+            return std::any_of(columns.begin(), columns.begin() + count,
+                [&](ColumnBase* column) { return column->version() > since; });
+        }
+
+        bool changed(std::uint64_t since, std::size_t row) const
+        {
+            return std::any_of(columns.begin(), columns.begin() + count,
+                [&](ColumnBase* column) { return column->versions()[row] > since; });
+        }
+    };
+
+    template <typename F>
+    void eachChanged(Archetype& archetype, F& fn) const
+    {
+        Tracked tracked(archetype);
+        if (!tracked.changed(m_since)) {
+            return;
+        }
+        auto changed = [&](std::size_t row) { return tracked.changed(m_since, row); };
+
+        // visit runs of changed rows, so columns are resolved once per run
+        std::size_t size = archetype.size();
+        for (std::size_t row = 0; row < size;) {
+            if (!changed(row)) {
+                ++row;
+                continue;
+            }
+            std::size_t end = row + 1;
+            while (end < size && changed(end)) {
+                ++end;
+            }
+            each(archetype, row, end, fn);
+            row = end;
+        }
+    }
+
+public:
+    class Iterator {
+        friend class View;
+
+        View const* m_view = nullptr;
+        std::size_t m_archetype = 0;
+        std::size_t m_row = 0;
+
+        // null until the current archetype is entered
+        Entity* m_entities = nullptr;
+        std::tuple<Rows<Ts>...> m_columns;
+        Tracked m_tracked;
+
+        Iterator(View const& view, std::size_t archetype)
+            : m_view(&view)
+            , m_archetype(archetype)
+        {
+            moveToNext();
+        }
+
+        // Stops at the current row or the next one to visit. Without
+        // changedSince a whole archetype is marked as changed when it is
+        // entered, with it only the rows visited are.
+        void moveToNext()
+        {
+            auto const& archetypes = *m_view->m_archetypes;
+            std::uint64_t since = m_view->m_since;
+            for (; m_archetype < archetypes.size(); ++m_archetype, m_row = 0, m_entities = nullptr) {
+                Archetype& archetype = *archetypes[m_archetype];
+                if (m_row >= archetype.size() || !m_view->accepts(archetype)) {
+                    continue;
+                }
+                if (!m_entities) {
+                    m_tracked = Tracked(archetype);
+                    if (since > 0 && !m_tracked.changed(since)) {
+                        continue;
+                    }
+                    if (since == 0) {
+                        touchAll(archetype, 0, archetype.size());
+                    }
+                    m_entities = archetype.entities();
+                    m_columns = std::tuple<Rows<Ts>...>(Rows<Ts>(archetype)...);
+                }
+                if (since > 0) {
+                    while (m_row < archetype.size() && !m_tracked.changed(since, m_row)) {
+                        ++m_row;
+                    }
+                    if (m_row == archetype.size()) {
+                        continue;
+                    }
+                    touchAll(archetype, m_row, m_row + 1);
+                }
+                return;
+            }
+        }
+
+        using Tuple = std::tuple<Entity&, typename ViewTerm<Ts>::Reference...>;
+
+        template <std::size_t... Is>
+        Tuple get(std::index_sequence<Is...>) const
+        {
+            return Tuple(m_entities[m_row], std::get<Is>(m_columns)[m_row]...);
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Tuple;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Tuple;
+
+        Iterator& operator++()
+        {
+            ++m_row;
+            moveToNext();
+            return *this;
+        }
+
+        bool operator==(Iterator const& other) const
+        {
+            return m_archetype == other.m_archetype && m_row == other.m_row;
+        }
+
+        bool operator!=(Iterator const& other) const { return !(*this == other); }
+
+        reference operator*() const { return get(std::index_sequence_for<Ts...>{}); }
+    };
+
+    explicit View(Query const& query)
+        : m_archetypes(&query.archetypes())
+    {
+    }
+
+    std::vector<Archetype*> const& archetypes() const { return *m_archetypes; }
+
+    // the iterators refer to the view, which must outlive them
+    Iterator begin() const { return Iterator(*this, 0); }
+
+    Iterator end() const { return Iterator(*this, m_archetypes->size()); }
+
+    // Restricts the view to entities also having all of Us, without passing
+    // them to the callback.
+    template <typename... Us>
+    View with() const
+    {
+        View view = *this;
+        view.m_with |= ComponentIds::signature<Us...>();
+        return view;
+    }
+
+    // Restricts the view to entities having none of Us, e.g. the tigers
+    // without a TigerCam.
+    template <typename... Us>
+    View without() const
+    {
+        View view = *this;
+        view.m_without |= ComponentIds::signature<Us...>();
+        return view;
+    }
+
+    // Restricts the view to entities for which any of Ts was added or
+    // accessed mutably after the given engine version.
+    View changedSince(std::uint64_t version) const
+    {
+        View view = *this;
+        view.m_since = version;
+        return view;
+    }
+
+    // calls fn(Entity&, Ts&...) for every matching entity
+    template <typename F>
+    void each(F&& fn) const
+    {
+        for (Archetype* archetype : *m_archetypes) {
+            if (!accepts(*archetype)) {
+                continue;
+            }
+            if (m_since > 0) {
+                eachChanged(*archetype, fn);
+            } else {
+                each(*archetype, 0, archetype->size(), fn);
+            }
+        }
+    }
+
+    // calls fn for the rows [begin, end) of one of the matched archetypes
+    template <typename F>
+    static void each(Archetype& archetype, std::size_t begin, std::size_t end, F&& fn)
+    {
+        touchAll(archetype, begin, end);
+        eachRow(fn, begin, end, archetype.entities(), Rows<Ts>(archetype)...);
+    }
+};
+}
+
+#endif // VIEW_H
@@ -0,0 +1,147 @@
+#include "components.h"
+#include "ecs/ecsengine.h"
+#include "world.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+// Runs the simulation without a window or OpenGL context and reports how
+// fast it goes.
+//
+//   graphics3_headless [-frames N] [-dt SECONDS] [-rate HZ] [-deterministic]
+//                      [-profile FRAMES] [-seed N] [-teapots N]
+//                      [-load FILE] [-save FILE] [-rollback TICKS]
+//
+// With -dt 0 every step gets the wall-clock time since the previous one,
+// otherwise each step advances the world by the given fixed amount. -rate
+// sets how many fixed simulation ticks make up one second. -profile prints
+// the time and allocations of each system every so many frames. Runs with
+// the same -seed, -dt and -rate simulate the same world. -teapots adds that
+// many more teapots, spread over the floor, to load the world with. -load
+// starts from the entities, tick count and seed of a snapshot instead, and
+// -save writes one at the end. -rollback keeps that many past ticks for
+// rewinding, to measure what it costs.
+
+static void usage()
+{
+    std::cerr << "usage: graphics3_headless [-frames N] [-dt SECONDS] [-rate HZ] [-deterministic] [-profile FRAMES] [-seed N] [-teapots N] [-load FILE] [-save FILE] [-rollback TICKS]\n";
+    std::exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    long frames = 10000;
+    float fixedDelta = 1.0f / 60;
+    float rate = 60;
+    bool deterministic = false;
+    long profileEvery = 0;
+    unsigned long long seed = 1;
+    long teapots = 0;
+    char const* loadPath = nullptr;
+    char const* savePath = nullptr;
+    long rollback = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-frames") && i + 1 < argc) {
+            frames = std::atol(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-dt") && i + 1 < argc) {
+            fixedDelta = static_cast<float>(std::atof(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-rate") && i + 1 < argc) {
+            rate = static_cast<float>(std::atof(argv[++i]));
+        } else if (!std::strcmp(argv[i], "-deterministic")) {
+            deterministic = true;
+        } else if (!std::strcmp(argv[i], "-profile") && i + 1 < argc) {
+            profileEvery = std::atol(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-seed") && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(argv[i], "-teapots") && i + 1 < argc) {
+            teapots = std::atol(argv[++i]);
+        } else if (!std::strcmp(argv[i], "-load") && i + 1 < argc) {
+            loadPath = argv[++i];
+        } else if (!std::strcmp(argv[i], "-save") && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (!std::strcmp(argv[i], "-rollback") && i + 1 < argc) {
+            rollback = std::atol(argv[++i]);
+        } else {
+            usage();
+        }
+    }
+    if (rate <= 0 || profileEvery < 0 || teapots < 0 || rollback < 0) {
+        usage();
+    }
+
+    try {
+        ou::ECSEngine engine;
+        engine.setDeterministic(deterministic);
+        engine.setFixedDelta(1.0f / rate);
+        engine.setSeed(seed);
+        if (profileEvery > 0) {
+            engine.setProfileDump(&std::cout, profileEvery);
+        }
+        populateWorld(engine);
+        engine.resource<SceneState>().windowSize = glm::ivec2(800, 800);
+
+        using namespace std::chrono;
+        if (loadPath) {
+            auto loadStart = steady_clock::now();
+            engine.loadSnapshot(loadPath);
+            std::cout << "loaded " << engine.countEntity() << " entities in "
+                      << duration<double>(steady_clock::now() - loadStart).count() << " s\n";
+        } else {
+            std::vector<ou::EntityId> ids = engine.instantiate(engine.resource<Prefabs const>().teapot, teapots);
+            auto side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(teapots))));
+            float spacing = 1000.0f / std::max<std::size_t>(side, 1);
+            for (std::size_t i = 0; i < ids.size(); ++i) {
+                glm::vec3 pos(-500.0f + (i % side + 0.5f) * spacing, 0, -500.0f + (i / side + 0.5f) * spacing);
+                engine.get<Hitbox>(ids[i]).pos = pos;
+                engine.get<LastPose>(ids[i]).pos = pos;
+            }
+        }
+        engine.setRollback(rollback);
+
+        auto start = steady_clock::now();
+        auto last = start;
+        double simulated = 0;
+
+        for (long frame = 0; frame < frames; ++frame) {
+            float delta = fixedDelta;
+            if (delta <= 0) {
+                auto now = steady_clock::now();
+                delta = duration<float>(now - last).count();
+                last = now;
+            }
+            engine.update(delta);
+            simulated += delta;
+        }
+
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+        std::cout << frames << " frames in " << elapsed << " s\n"
+                  << "  " << frames / elapsed << " frames/s, "
+                  << elapsed / frames * 1e6 << " us/frame\n"
+                  << "  " << simulated << " s simulated, "
+                  << simulated / elapsed << "x real time\n"
+                  << "  " << engine.ticks() << " ticks at " << rate << " Hz\n"
+                  << "  " << engine.countEntity() << " entities\n";
+        if (rollback > 0) {
+            std::cout << "  " << engine.rewindableTicks() << " ticks kept for rollback in "
+                      << engine.rollbackBytes() / 1024 << " KiB\n";
+        }
+
+        if (savePath) {
+            auto saveStart = steady_clock::now();
+            engine.saveSnapshot(savePath);
+            std::cout << "saved in " << duration<double>(steady_clock::now() - saveStart).count() << " s\n";
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Exception thrown: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,9 +1,24 @@
 #include "input.h"
 
+#ifdef OU_HEADLESS
+// there is no window system to talk to; button codes as in freeglut
+enum {
+    GLUT_LEFT_BUTTON = 0,
+    GLUT_RIGHT_BUTTON = 2,
+    GLUT_DOWN = 0,
+    GLUT_UP = 1,
+    GLUT_CURSOR_INHERIT = 100,
+    GLUT_CURSOR_NONE = 101,
+};
+
+static void glutSetCursor(int) {}
+static void glutWarpPointer(int, int) {}
+#else
 // clang-format off
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 // clang-format on
+#endif
 
 #include <iostream>
 
@@ -94,8 +109,8 @@ void Input::update(float delta, glm::ivec2 windowSize)
 
 void Input::afterUpdate()
 {
+    // clicks stay pending until taken, the simulation may not tick every frame
     m_mouseWheelDelta = 0;
-    m_mouseClicked = false;
 }
 
 bool Input::isMouseDown() const
@@ -117,6 +132,13 @@ bool Input::isMouseClicked() const
     return m_mouseClicked;
 }
 
+bool Input::takeMouseClick()
+{
+    bool clicked = m_mouseClicked;
+    m_mouseClicked = false;
+    return clicked;
+}
+
 bool Input::isMouseInScreen() const
 {
     return m_mouseInScreen;
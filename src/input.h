@@ -26,6 +26,9 @@ public:
 
     bool isMouseClicked() const;
 
+    // returns whether there was a click since the last call, and forgets it
+    bool takeMouseClick();
+
     bool isMouseInScreen() const;
     glm::ivec2 mousePos() const;
 
@@ -130,6 +130,13 @@ void ObjectModel::render(ou::Shader& shader, glm::mat4 modelViewMat, glm::mat4 p
     glDrawArrays(GL_TRIANGLES, m_vertexOffset[frame], m_nVertices[frame]);
 }
 
+// pose between the last two simulation ticks, alpha being how far along
+static LastPose interpolate(LastPose const& last, glm::vec3 pos, float angle, float alpha)
+{
+    float delta = glm::mod(angle - last.angle + glm::radians(180.0f), glm::radians(360.0f)) - glm::radians(180.0f);
+    return { glm::mix(last.pos, pos, alpha), last.angle + delta * alpha };
+}
+
 RenderSystem::RenderSystem()
     : m_simpleShader("Shaders/simple.vert", "Shaders/simple.frag")
     , m_phongShader("Shaders/Phong_Tx.vert", "Shaders/Phong_Tx.frag")
@@ -204,6 +211,9 @@ RenderSystem::RenderSystem()
     prepareIronman();
     prepareWolf();
     prepareSpider();
+
+    reads<SceneState, Tiger, TigerCam, Wolf, Spider, Car, CarCam, Teapot, Hitbox, LastPose>();
+    runOnMainThread();
 }
 
 void RenderSystem::initLightsAndMaterial()
@@ -363,7 +373,8 @@ void RenderSystem::prepareSpider()
 
 void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov)
 {
-    SceneState const& scene = engine.getOne<SceneState>();
+    SceneState const& scene = engine.resource<SceneState const>();
+    float alpha = engine.interpolation();
     float aspectRatio = static_cast<float>(scene.windowSize.x) / scene.windowSize.y;
     glm::mat4 projectionMatrix = glm::perspective(glm::radians(fov), aspectRatio, 20.0f, 20000.0f);
 
@@ -411,13 +422,13 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
     }
 
     // draw tigers
-    for (ou::Entity const& ent : engine.iterate<Tiger>()) {
-        auto const& tiger = ent.get<Tiger>();
-        auto const& hitbox = ent.get<Hitbox>();
+    engine.view<Tiger const, Hitbox const, LastPose const>().each([&](ou::Entity const&, Tiger const& tiger, Hitbox const& hitbox, LastPose const& last) {
+
+        LastPose pose = interpolate(last, hitbox.pos, tiger.angle, alpha);
 
         glm::mat4 modelViewMatrix;
-        modelViewMatrix = glm::translate(viewMatrix, hitbox.pos);
-        modelViewMatrix = glm::rotate(modelViewMatrix, tiger.angle, glm::vec3(0, 1, 0));
+        modelViewMatrix = glm::translate(viewMatrix, pose.pos);
+        modelViewMatrix = glm::rotate(modelViewMatrix, pose.angle, glm::vec3(0, 1, 0));
         modelViewMatrix = glm::rotate(modelViewMatrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
         modelViewMatrix = glm::scale(modelViewMatrix, glm::vec3(0.5f));
 
@@ -431,11 +442,10 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
         glActiveTexture(GL_TEXTURE0);
         m_tigerTexture.use(GL_TEXTURE_2D);
         m_tiger.render(m_phongShader, modelViewMatrix, projectionMatrix, tiger.currFrame);
-    }
+    });
 
     // draw wolf
-    for (ou::Entity const& ent : engine.iterate<Wolf>()) {
-        Wolf const& wolf = ent.get<Wolf>();
+    engine.view<Wolf const>().each([&](ou::Entity const&, Wolf const& wolf) {
 
         glm::mat4 modelViewMatrix;
         modelViewMatrix = viewMatrix;
@@ -449,17 +459,17 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
         glFrontFace(GL_CW);
         m_phongShader.use();
         m_wolf.render(m_phongShader, modelViewMatrix, projectionMatrix, wolf.currFrame);
-    }
+    });
 
     // draw spider
-    for (ou::Entity const& ent : engine.iterate<Spider>()) {
-        auto const& spider = ent.get<Spider>();
-        auto const& hitbox = ent.get<Hitbox>();
+    engine.view<Spider const, Hitbox const, LastPose const>().each([&](ou::Entity const&, Spider const& spider, Hitbox const& hitbox, LastPose const& last) {
+
+        LastPose pose = interpolate(last, hitbox.pos, spider.angle, alpha);
 
         glm::mat4 modelViewMatrix;
         modelViewMatrix = viewMatrix;
-        modelViewMatrix = glm::translate(modelViewMatrix, hitbox.pos);
-        modelViewMatrix = glm::rotate(modelViewMatrix, spider.angle, glm::vec3(0, 1, 0));
+        modelViewMatrix = glm::translate(modelViewMatrix, pose.pos);
+        modelViewMatrix = glm::rotate(modelViewMatrix, pose.angle, glm::vec3(0, 1, 0));
         modelViewMatrix = glm::scale(modelViewMatrix, glm::vec3(80.0f));
         modelViewMatrix = glm::rotate(modelViewMatrix, glm::radians(180.0f), glm::vec3(0, 0, 1));
 
@@ -470,7 +480,7 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
         glFrontFace(GL_CW);
         m_phongShader.use();
         m_spider.render(m_phongShader, modelViewMatrix, projectionMatrix, spider.currFrame);
-    }
+    });
 
     // draw ironman
     {
@@ -490,12 +500,13 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
     }
 
     // draw car
-    for (ou::Entity const& ent : engine.iterate<Car>()) {
-        Car const& car = ent.get<Car>();
+    engine.view<Car const, LastPose const>().each([&](ou::Entity const&, Car const& car, LastPose const& last) {
+
+        LastPose pose = interpolate(last, glm::vec3(car.pos.x, 0.0f, car.pos.y), car.angle, alpha);
 
         glm::mat4 modelMatrix(1.0f);
-        modelMatrix = glm::translate(modelMatrix, glm::vec3(car.pos.x, 0.0f, car.pos.y));
-        modelMatrix = glm::rotate(modelMatrix, car.angle, glm::vec3(0, 1, 0));
+        modelMatrix = glm::translate(modelMatrix, pose.pos);
+        modelMatrix = glm::rotate(modelMatrix, pose.angle, glm::vec3(0, 1, 0));
         modelMatrix = glm::scale(modelMatrix, glm::vec3(10.0f, 10.0f, 10.0f));
         modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 4.89f, -4.0f));
         modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -548,19 +559,10 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
         wheelModelMatrix = glm::rotate(wheelModelMatrix, car.rearRot, glm::vec3(0, 1, 0));
         wheelModelMatrix = glm::rotate(wheelModelMatrix, car.wheelAngle, glm::vec3(0, 0, 1));
         drawWheelAndNut(wheelModelMatrix, -1.0f);
-    }
+    });
 
     // draw teapot
-    for (ou::Entity const& ent : engine.iterate<Teapot>()) {
-        auto const& teapot = ent.get<Teapot>();
-        auto const& hitbox = ent.get<Hitbox>();
-
-        glm::mat4 modelMatrix(1.0f);
-        modelMatrix = glm::translate(modelMatrix, hitbox.pos);
-        modelMatrix = glm::rotate(modelMatrix, teapot.angle, glm::vec3(0, 1, 0));
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(20.0f));
-        modelMatrix = glm::translate(modelMatrix, glm::vec3(0, 1.6f, 0));
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.0f), glm::vec3(1, 0, 0));
+    for (glm::mat4 const& modelMatrix : m_teapotModels) {
 
         m_teapotMaterial.setMaterial(m_phongShader);
 
@@ -603,9 +605,73 @@ void RenderSystem::render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov
     }
 }
 
+void RenderSystem::updateTeapotModels(ou::ECSEngine& engine)
+{
+    float alpha = engine.interpolation();
+
+    // Teapots changed by the last tick are between two poses, so their
+    // matrices follow alpha from frame to frame; the others keep theirs until
+    // they change again.
+    if (engine.ticks() != m_teapotTicks) {
+        m_teapotTicks = engine.ticks();
+        m_teapotSince = m_teapotVersion;
+    }
+    m_teapotVersion = engine.version();
+
+    auto teapots = engine.view<Teapot const, Hitbox const, LastPose const>();
+    teapots.changedSince(m_teapotSince).each([&](ou::Entity const& ent, Teapot const& teapot, Hitbox const& hitbox, LastPose const& last) {
+
+        LastPose pose = interpolate(last, hitbox.pos, teapot.angle, alpha);
+
+        glm::mat4 modelMatrix(1.0f);
+        modelMatrix = glm::translate(modelMatrix, pose.pos);
+        modelMatrix = glm::rotate(modelMatrix, pose.angle, glm::vec3(0, 1, 0));
+        modelMatrix = glm::scale(modelMatrix, glm::vec3(20.0f));
+        modelMatrix = glm::translate(modelMatrix, glm::vec3(0, 1.6f, 0));
+        modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.0f), glm::vec3(1, 0, 0));
+
+        ou::EntityId id = ent.id();
+        if (id.index >= m_teapotSlots.size()) {
+            m_teapotSlots.resize(id.index + 1, UINT32_MAX);
+        }
+        std::uint32_t& slot = m_teapotSlots[id.index];
+        if (slot == UINT32_MAX) {
+            slot = static_cast<std::uint32_t>(m_teapotModels.size());
+            m_teapotModels.push_back(modelMatrix);
+            m_teapotIds.push_back(id);
+        } else {
+            m_teapotModels[slot] = modelMatrix;
+            m_teapotIds[slot] = id;
+        }
+    });
+
+    // more matrices than teapots means some were destroyed or reused
+    std::size_t count = 0;
+    for (ou::Archetype* archetype : teapots.archetypes()) {
+        count += archetype->size();
+    }
+    for (std::size_t i = 0; m_teapotIds.size() > count && i < m_teapotIds.size();) {
+        if (engine.has<Teapot>(m_teapotIds[i])) {
+            ++i;
+            continue;
+        }
+        m_teapotSlots[m_teapotIds[i].index] = UINT32_MAX;
+        if (i + 1 < m_teapotIds.size()) {
+            m_teapotModels[i] = m_teapotModels.back();
+            m_teapotIds[i] = m_teapotIds.back();
+            m_teapotSlots[m_teapotIds[i].index] = static_cast<std::uint32_t>(i);
+        }
+        m_teapotModels.pop_back();
+        m_teapotIds.pop_back();
+    }
+}
+
 void RenderSystem::update(ou::ECSEngine& engine, float)
 {
-    SceneState const& scene = engine.getOne<SceneState>();
+    SceneState const& scene = engine.resource<SceneState const>();
+
+    // shared by all viewports
+    updateTeapotModels(engine);
 
     // Primary camera
     {
@@ -630,11 +696,13 @@ void RenderSystem::update(ou::ECSEngine& engine, float)
         glViewport(scene.windowSize.x / 2, 0, scene.windowSize.x / 2, scene.windowSize.y / 2);
         glScissor(scene.windowSize.x / 2, 0, scene.windowSize.x / 2, scene.windowSize.y / 2);
 
-        Car const& car = engine.getOneEnt<CarCam>().get<Car>();
+        auto const& carEnt = engine.getOneEnt<CarCam>();
+        auto const& car = carEnt.get<Car>();
+        LastPose pose = interpolate(carEnt.get<LastPose>(), glm::vec3(car.pos.x, 0.0f, car.pos.y), car.angle, engine.interpolation());
 
-        glm::mat3 rot = glm::mat3(glm::rotate(glm::mat4(1.0f), car.angle, glm::vec3(0, 1, 0)));
+        glm::mat3 rot = glm::mat3(glm::rotate(glm::mat4(1.0f), pose.angle, glm::vec3(0, 1, 0)));
 
-        glm::vec3 pos = glm::vec3(car.pos.x, 80.0f, car.pos.y) + rot * glm::vec3(0, 0, 68.0f);
+        glm::vec3 pos = pose.pos + glm::vec3(0, 80.0f, 0) + rot * glm::vec3(0, 0, 68.0f);
         glm::vec3 lookDir = rot * glm::vec3(0, 0, 1);
 
         glm::mat4 viewMatrix = glm::lookAt(pos - lookDir * 80.0f, pos + lookDir, glm::vec3(0, 1, 0));
@@ -649,9 +717,10 @@ void RenderSystem::update(ou::ECSEngine& engine, float)
         auto const& tigerEnt = engine.getOneEnt<TigerCam>();
         auto const& tiger = tigerEnt.get<Tiger>();
         auto const& hitbox = tigerEnt.get<Hitbox>();
+        LastPose pose = interpolate(tigerEnt.get<LastPose>(), hitbox.pos, tiger.angle, engine.interpolation());
 
-        glm::mat3 rot = glm::mat3(glm::rotate(glm::mat4(1.0f), tiger.angle, glm::vec3(0, 1, 0)));
-        glm::vec3 pos = hitbox.pos + rot * glm::vec3(0, 60.0f, 50.0f);
+        glm::mat3 rot = glm::mat3(glm::rotate(glm::mat4(1.0f), pose.angle, glm::vec3(0, 1, 0)));
+        glm::vec3 pos = pose.pos + rot * glm::vec3(0, 60.0f, 50.0f);
         glm::vec3 lookDir = rot * glm::vec3(0, -0.1f, 1);
 
         glm::mat4 viewMatrix = glm::lookAt(pos, pos + lookDir, glm::vec3(0, 1, 0));
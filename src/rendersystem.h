@@ -1,12 +1,14 @@
 #ifndef RENDERSYSTEM_H
 #define RENDERSYSTEM_H
 
+#include "ecs/entity.h"
 #include "ecs/entitysystem.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
 #include "graphics/vertexarray.h"
 #include "graphics/vertexbuffer.h"
 
+#include <cstdint>
 #include <functional>
 #include <glm/glm.hpp>
 #include <vector>
@@ -59,6 +61,7 @@ private:
     void prepareWolf();
     void prepareSpider();
 
+    void updateTeapotModels(ou::ECSEngine& engine);
     void render(ou::ECSEngine& engine, glm::mat4 viewMatrix, float fov);
 
 private:
@@ -97,6 +100,17 @@ private:
     ObjectModel m_teapot;
     PhongMaterial m_teapotMaterial;
 
+    // model matrices of the teapots for the current frame, shared by all
+    // viewports, and whose they are; a teapot at rest keeps its matrix
+    std::vector<glm::mat4> m_teapotModels;
+    std::vector<ou::EntityId> m_teapotIds;
+    // index into the above by entity index, UINT32_MAX for none
+    std::vector<std::uint32_t> m_teapotSlots;
+    // teapots changed after m_teapotSince are recomputed every frame
+    std::uint64_t m_teapotTicks = 0;
+    std::uint64_t m_teapotVersion = 0;
+    std::uint64_t m_teapotSince = 0;
+
     ObjectModel m_ironman;
     PhongMaterial m_ironmanMaterial;
 };
@@ -1,10 +1,8 @@
 #include "scene.h"
-#include "animationsystem.h"
 #include "components.h"
-#include "controlsystem.h"
-#include "ecs/entity.h"
 #include "input.h"
 #include "rendersystem.h"
+#include "world.h"
 
 // clang-format off
 #include <GL/glew.h>
@@ -15,32 +13,16 @@
 
 Scene::Scene()
     : m_engine{}
-    , m_lastFrame{ std::chrono::system_clock::now() }
+    , m_lastFrame{ std::chrono::steady_clock::now() }
 {
-    SceneState state;
-    state.second.eyePos = glm::vec3(200, 110, 0);
-    state.second.lookDir = glm::vec3(-1, 0, 0);
-    state.second.upDir = glm::vec3(0.0f, 1.0f, 0.0f);
-    state.second.fov = 120.0f;
-
-    m_engine.addEntity(ou::Entity{ state, Input{} });
-    m_engine.addEntity(ou::Entity{ Tiger{}, Hitbox{} });
-    m_engine.addEntity(ou::Entity{ Tiger{ 0, 3.0f }, TigerCam{}, Hitbox{} });
-    m_engine.addEntity(ou::Entity{ Car{}, CarCam{}, Hitbox{} });
-    m_engine.addEntity(ou::Entity{ Car{}, Hitbox{} });
-    m_engine.addEntity(ou::Entity{ Teapot{}, Hitbox{ glm::vec3(-300.0f, 0, -200.f) } });
-    m_engine.addEntity(ou::Entity{ Wolf{} });
-    m_engine.addEntity(ou::Entity{ Spider{}, Hitbox{ glm::vec3(80.0f, 0, 0), 5.f } });
-
-    m_engine.addSystem(std::make_unique<AnimationSystem>());
-    m_engine.addSystem(std::make_unique<ControlSystem>(), 8);
+    populateWorld(m_engine);
     m_engine.addSystem(std::make_unique<RenderSystem>(), 9);
 }
 
 void Scene::render()
 {
     using namespace std::chrono;
-    auto now = system_clock::now();
+    auto now = steady_clock::now();
     float delta = duration<float>(now - m_lastFrame).count();
     m_lastFrame = now;
 
@@ -52,41 +34,41 @@ void Scene::render()
 void Scene::mouseClick(int button, int event)
 {
     if (button == GLUT_LEFT_BUTTON || button == GLUT_RIGHT_BUTTON) {
-        m_engine.getOne<Input>().mouseClick(button, event);
+        m_engine.resource<Input>().mouseClick(button, event);
     } else if (button == 3) {
-        m_engine.getOne<Input>().mouseScroll(-1);
+        m_engine.resource<Input>().mouseScroll(-1);
     } else if (button == 4) {
-        m_engine.getOne<Input>().mouseScroll(1);
+        m_engine.resource<Input>().mouseScroll(1);
     }
 }
 
 void Scene::mouseMove(int x, int y)
 {
-    m_engine.getOne<Input>().mouseMove(x, y);
+    m_engine.resource<Input>().mouseMove(x, y);
 }
 
 void Scene::mouseEnter()
 {
-    m_engine.getOne<Input>().mouseEnter();
+    m_engine.resource<Input>().mouseEnter();
 }
 
 void Scene::mouseLeft()
 {
-    m_engine.getOne<Input>().mouseLeft();
+    m_engine.resource<Input>().mouseLeft();
 }
 
 void Scene::keyDown(unsigned char key)
 {
-    m_engine.getOne<Input>().keyDown(key);
+    m_engine.resource<Input>().keyDown(key);
 }
 
 void Scene::keyUp(unsigned char key)
 {
-    m_engine.getOne<Input>().keyUp(key);
+    m_engine.resource<Input>().keyUp(key);
 }
 
 void Scene::reshapeWindow(int width, int height)
 {
     glViewport(0, 0, width, height);
-    m_engine.getOne<SceneState>().windowSize = glm::ivec2(width, height);
+    m_engine.resource<SceneState>().windowSize = glm::ivec2(width, height);
 }
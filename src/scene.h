@@ -22,7 +22,7 @@ public:
 
 private:
     ou::ECSEngine m_engine;
-    std::chrono::system_clock::time_point m_lastFrame;
+    std::chrono::steady_clock::time_point m_lastFrame;
 };
 
 #endif // SCENE_H
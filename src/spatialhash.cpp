@@ -0,0 +1,88 @@
+#include "spatialhash.h"
+
+#include <algorithm>
+#include <cmath>
+
+// 21 bits per axis, so cells up to a million widths from the origin have
+// keys of their own
+static std::uint64_t keyOf(glm::ivec3 coords)
+{
+    auto bits = [](int value) { return static_cast<std::uint64_t>(value + (1 << 20)) & 0x1FFFFF; };
+    return bits(coords.x) << 42 | bits(coords.y) << 21 | bits(coords.z);
+}
+
+static std::size_t slotOf(std::uint64_t key, std::size_t mask)
+{
+    // spread the bits of all three coordinates over the low ones
+    key *= 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(key >> 32) & mask;
+}
+
+void SpatialHash::clear()
+{
+    m_centers.clear();
+    m_maxRadius = 0;
+}
+
+void SpatialHash::insert(glm::vec3 center, float radius)
+{
+    m_centers.push_back(center);
+    m_maxRadius = std::max(m_maxRadius, radius);
+}
+
+void SpatialHash::build()
+{
+    m_entries.clear();
+    m_cells.clear();
+
+    // overlapping spheres are closer than two of the largest radius on
+    // every axis, so they cannot be more than one cell apart
+    m_cellSize = std::max(2 * m_maxRadius, 1e-3f);
+    for (std::size_t i = 0; i < m_centers.size(); ++i) {
+        m_entries.push_back({ keyOf(coordsOf(m_centers[i])), static_cast<std::uint32_t>(i) });
+    }
+    std::sort(m_entries.begin(), m_entries.end(), [](Entry const& a, Entry const& b) {
+        return a.cell != b.cell ? a.cell < b.cell : a.item < b.item;
+    });
+
+    for (std::size_t i = 0; i < m_entries.size();) {
+        std::size_t end = i + 1;
+        while (end < m_entries.size() && m_entries[end].cell == m_entries[i].cell) {
+            ++end;
+        }
+        glm::ivec3 coords = coordsOf(m_centers[m_entries[i].item]);
+        m_cells.push_back({ coords, static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(end) });
+        i = end;
+    }
+
+    std::size_t slots = 16;
+    while (slots < 2 * m_cells.size()) {
+        slots *= 2;
+    }
+    m_table.assign(slots, 0);
+    for (std::size_t i = 0; i < m_cells.size(); ++i) {
+        std::size_t slot = slotOf(keyOf(m_cells[i].coords), slots - 1);
+        while (m_table[slot]) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        m_table[slot] = static_cast<std::uint32_t>(i + 1);
+    }
+}
+
+glm::ivec3 SpatialHash::coordsOf(glm::vec3 center) const
+{
+    return glm::ivec3(glm::floor(center / m_cellSize));
+}
+
+SpatialHash::Cell const* SpatialHash::find(glm::ivec3 coords) const
+{
+    std::uint64_t key = keyOf(coords);
+    std::size_t mask = m_table.size() - 1;
+    for (std::size_t slot = slotOf(key, mask); m_table[slot]; slot = (slot + 1) & mask) {
+        Cell const& cell = m_cells[m_table[slot] - 1];
+        if (keyOf(cell.coords) == key) {
+            return &cell;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,86 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Broad phase for collisions between spheres. Items are bucketed by the cell
+// of a uniform grid their centre falls in, with cells as wide as the largest
+// sphere, so two spheres can only overlap if their cells are neighbours.
+// The storage is kept from one build to the next.
+class SpatialHash {
+    struct Entry {
+        std::uint64_t cell;
+        std::uint32_t item;
+    };
+
+    struct Cell {
+        glm::ivec3 coords;
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    std::vector<glm::vec3> m_centers;
+    float m_maxRadius = 0;
+    float m_cellSize = 1;
+
+    // sorted by cell, then by item
+    std::vector<Entry> m_entries;
+    std::vector<Cell> m_cells;
+    // open addressing over m_cells, holding index + 1 and 0 for empty slots
+    std::vector<std::uint32_t> m_table;
+
+    glm::ivec3 coordsOf(glm::vec3 center) const;
+    Cell const* find(glm::ivec3 coords) const;
+
+public:
+    void clear();
+
+    // adds the next item, numbered from 0 in order of insertion
+    void insert(glm::vec3 center, float radius);
+
+    // buckets the items inserted since clear
+    void build();
+
+    // Calls fn(a, b) once for every pair of items a < b in the same or
+    // neighbouring cells, in an order that only depends on the items.
+    template <typename F>
+    void forEachPair(F fn) const;
+};
+
+template <typename F>
+void SpatialHash::forEachPair(F fn) const
+{
+    // half of the 26 neighbours, so each pair of cells is visited once
+    static glm::ivec3 const forward[13] = {
+        { 1, 0, 0 }, { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+        { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 }, { -1, 0, 1 }, { 0, 0, 1 },
+        { 1, 0, 1 }, { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+    };
+
+    for (Cell const& cell : m_cells) {
+        for (std::uint32_t i = cell.begin; i < cell.end; ++i) {
+            for (std::uint32_t j = i + 1; j < cell.end; ++j) {
+                fn(m_entries[i].item, m_entries[j].item);
+            }
+        }
+        for (glm::ivec3 const& offset : forward) {
+            Cell const* other = find(cell.coords + offset);
+            if (!other) {
+                continue;
+            }
+            for (std::uint32_t i = cell.begin; i < cell.end; ++i) {
+                for (std::uint32_t j = other->begin; j < other->end; ++j) {
+                    std::uint32_t a = m_entries[i].item;
+                    std::uint32_t b = m_entries[j].item;
+                    fn(a < b ? a : b, a < b ? b : a);
+                }
+            }
+        }
+    }
+}
+
+#endif // SPATIALHASH_H
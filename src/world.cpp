@@ -0,0 +1,82 @@
+#include "world.h"
+#include "animationsystem.h"
+#include "components.h"
+#include "controlsystem.h"
+#include "ecs/entity.h"
+#include "input.h"
+
+#include <cstdint>
+
+// cars keep a queue of destinations, so they are saved field by field
+static void saveCar(Car const& car, ou::SnapshotWriter& out)
+{
+    out.value(car.elapsedTime);
+    out.value(car.interval);
+    out.value(car.wheelAngle);
+    out.value(car.pos);
+    out.value(car.dir);
+    out.value(car.angle);
+    out.value(car.wheelRot);
+    out.value(car.rearRot);
+    out.value(static_cast<std::uint32_t>(car.dests.size()));
+    for (glm::vec2 const& dest : car.dests) {
+        out.value(dest);
+    }
+}
+
+static Car loadCar(ou::SnapshotReader& in)
+{
+    Car car;
+    car.elapsedTime = in.value<float>();
+    car.interval = in.value<float>();
+    car.wheelAngle = in.value<float>();
+    car.pos = in.value<glm::vec2>();
+    car.dir = in.value<glm::vec2>();
+    car.angle = in.value<float>();
+    car.wheelRot = in.value<float>();
+    car.rearRot = in.value<float>();
+    for (std::uint32_t dests = in.value<std::uint32_t>(); dests > 0; --dests) {
+        car.dests.push_back(in.value<glm::vec2>());
+    }
+    return car;
+}
+
+void registerComponents(ou::ECSEngine& engine)
+{
+    engine.registerComponent<Tiger>("Tiger");
+    engine.registerComponent<Wolf>("Wolf");
+    engine.registerComponent<Hitbox>("Hitbox");
+    engine.registerComponent<LastPose>("LastPose");
+    engine.registerComponent<Spider>("Spider");
+    engine.registerComponent<Teapot>("Teapot");
+    engine.registerComponent<TigerCam>("TigerCam");
+    engine.registerComponent<Car>("Car", &saveCar, &loadCar);
+    engine.registerComponent<CarCam>("CarCam");
+}
+
+void populateWorld(ou::ECSEngine& engine)
+{
+    registerComponents(engine);
+
+    SceneState state;
+    state.second.eyePos = glm::vec3(200, 110, 0);
+    state.second.lookDir = glm::vec3(-1, 0, 0);
+    state.second.upDir = glm::vec3(0.0f, 1.0f, 0.0f);
+    state.second.fov = 120.0f;
+
+    engine.setResource(state);
+    engine.setResource(Input{});
+    engine.addEntity(ou::Entity{ Tiger{}, Hitbox{}, LastPose{} });
+    engine.addEntity(ou::Entity{ Tiger{ 0, 3.0f }, TigerCam{}, Hitbox{}, LastPose{} });
+    engine.addEntity(ou::Entity{ Car{}, CarCam{}, Hitbox{}, LastPose{} });
+    engine.addEntity(ou::Entity{ Car{}, Hitbox{}, LastPose{} });
+    Prefabs prefabs;
+    prefabs.teapot = engine.addPrefab(ou::Entity{ Teapot{}, Hitbox{}, LastPose{} });
+    engine.setResource(prefabs);
+    engine.instantiate(prefabs.teapot, 1, ou::Entity{ Hitbox{ glm::vec3(-300.0f, 0, -200.f) }, LastPose{ glm::vec3(-300.0f, 0, -200.f) } });
+    engine.addEntity(ou::Entity{ Wolf{} });
+    engine.addEntity(ou::Entity{ Spider{}, Hitbox{ glm::vec3(80.0f, 0, 0), 5.f }, LastPose{ glm::vec3(80.0f, 0, 0) } });
+
+    engine.addSystem(std::make_unique<AnimationSystem>());
+    engine.addSystem(std::make_unique<ControlSystem>(), 8);
+}
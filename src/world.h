@@ -0,0 +1,20 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "ecs/ecsengine.h"
+
+// Prefabs of the scene, kept as a resource of the engine
+struct Prefabs {
+    ou::PrefabId teapot;
+};
+
+// Names the component types of the scene so its entities can be saved to
+// and loaded from snapshots.
+void registerComponents(ou::ECSEngine& engine);
+
+// Registers the components and prefabs and adds the resources, entities and simulation
+// systems of the scene, that is everything except rendering, so the world can
+// also run without a window.
+void populateWorld(ou::ECSEngine& engine);
+
+#endif // WORLD_H